@@ -30,6 +30,11 @@
   <terrain name="Sewer" tile="484"/>
   <terrain name="Sewer Water" tile="481"/>
  </terraintypes>
+ <tile id="0">
+  <properties>
+   <property name="autotile" value="ground"/>
+  </properties>
+ </tile>
  <tile id="1" terrain="11,11,11,"/>
  <tile id="2" terrain="11,11,,11"/>
  <tile id="4" terrain="0,0,0,"/>
@@ -38,16 +43,44 @@
  <tile id="8" terrain="1,1,,1"/>
  <tile id="13" terrain="3,3,3,"/>
  <tile id="14" terrain="3,3,,3"/>
- <tile id="16" terrain="4,4,4,"/>
- <tile id="17" terrain="4,4,,4"/>
+ <tile id="15">
+  <properties>
+   <property name="autotile" value="lava"/>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
+ <tile id="16" terrain="4,4,4,">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
+ <tile id="17" terrain="4,4,,4">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
  <tile id="19" terrain="5,5,5,"/>
  <tile id="20" terrain="5,5,,5"/>
  <tile id="22" terrain="6,6,6,"/>
  <tile id="23" terrain="6,6,,6"/>
  <tile id="25" terrain="7,7,7,"/>
  <tile id="26" terrain="7,7,,7"/>
- <tile id="28" terrain="8,8,8,"/>
- <tile id="29" terrain="8,8,,8"/>
+ <tile id="27">
+  <properties>
+   <property name="autotile" value="water"/>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
+ <tile id="28" terrain="8,8,8,">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
+ <tile id="29" terrain="8,8,,8">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
  <tile id="33" terrain="11,,11,11"/>
  <tile id="34" terrain=",11,11,11"/>
  <tile id="36" terrain="0,,0,0"/>
@@ -56,16 +89,42 @@
  <tile id="40" terrain=",1,1,1"/>
  <tile id="45" terrain="3,,3,3"/>
  <tile id="46" terrain=",3,3,3"/>
- <tile id="48" terrain="4,,4,4"/>
- <tile id="49" terrain=",4,4,4"/>
+ <tile id="48" terrain="4,,4,4">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
+ <tile id="49" terrain=",4,4,4">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
+ <tile id="50">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
  <tile id="51" terrain="5,,5,5"/>
  <tile id="52" terrain=",5,5,5"/>
  <tile id="54" terrain="6,,6,6"/>
  <tile id="55" terrain=",6,6,6"/>
  <tile id="57" terrain="7,,7,7"/>
  <tile id="58" terrain=",7,7,7"/>
- <tile id="60" terrain="8,,8,8"/>
- <tile id="61" terrain=",8,8,8"/>
+ <tile id="60" terrain="8,,8,8">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
+ <tile id="61" terrain=",8,8,8">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
+ <tile id="62">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
  <tile id="64" terrain=",,,11"/>
  <tile id="65" terrain=",,11,11"/>
  <tile id="66" terrain=",,11,"/>
@@ -81,9 +140,21 @@
  <tile id="76" terrain=",,,3"/>
  <tile id="77" terrain=",,3,3"/>
  <tile id="78" terrain=",,3,"/>
- <tile id="79" terrain=",,,4"/>
- <tile id="80" terrain=",,4,4"/>
- <tile id="81" terrain=",,4,"/>
+ <tile id="79" terrain=",,,4">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
+ <tile id="80" terrain=",,4,4">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
+ <tile id="81" terrain=",,4,">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
  <tile id="82" terrain=",,,5"/>
  <tile id="83" terrain=",,5,5"/>
  <tile id="84" terrain=",,5,"/>
@@ -93,9 +164,21 @@
  <tile id="88" terrain=",,,7"/>
  <tile id="89" terrain=",,7,7"/>
  <tile id="90" terrain=",,7,"/>
- <tile id="91" terrain=",,,8"/>
- <tile id="92" terrain=",,8,8"/>
- <tile id="93" terrain=",,8,"/>
+ <tile id="91" terrain=",,,8">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
+ <tile id="92" terrain=",,8,8">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
+ <tile id="93" terrain=",,8,">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
  <tile id="96" terrain=",11,,11"/>
  <tile id="97" terrain="11,11,11,11"/>
  <tile id="98" terrain="11,,11,"/>
@@ -110,9 +193,21 @@
  <tile id="107" terrain="2,,2,"/>
  <tile id="108" terrain=",3,,3"/>
  <tile id="110" terrain="3,,3,"/>
- <tile id="111" terrain=",4,,4"/>
- <tile id="112" terrain="4,4,4,4"/>
- <tile id="113" terrain="4,,4,"/>
+ <tile id="111" terrain=",4,,4">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
+ <tile id="112" terrain="4,4,4,4">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
+ <tile id="113" terrain="4,,4,">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
  <tile id="114" terrain=",5,,5"/>
  <tile id="115" terrain="5,5,5,5"/>
  <tile id="116" terrain="5,,5,"/>
@@ -121,8 +216,21 @@
  <tile id="119" terrain="6,,6,"/>
  <tile id="120" terrain=",7,,7"/>
  <tile id="122" terrain="7,,7,"/>
- <tile id="123" terrain=",8,,8"/>
- <tile id="125" terrain="8,,8,"/>
+ <tile id="123" terrain=",8,,8">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
+ <tile id="124">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
+ <tile id="125" terrain="8,,8,">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
  <tile id="128" terrain=",11,,"/>
  <tile id="129" terrain="11,11,,"/>
  <tile id="130" terrain="11,,,"/>
@@ -138,9 +246,21 @@
  <tile id="140" terrain=",3,,"/>
  <tile id="141" terrain="3,3,,"/>
  <tile id="142" terrain="3,,,"/>
- <tile id="143" terrain=",4,,"/>
- <tile id="144" terrain="4,4,,"/>
- <tile id="145" terrain="4,,,"/>
+ <tile id="143" terrain=",4,,">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
+ <tile id="144" terrain="4,4,,">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
+ <tile id="145" terrain="4,,,">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
  <tile id="146" terrain=",5,,"/>
  <tile id="147" terrain="5,5,,"/>
  <tile id="148" terrain="5,,,"/>
@@ -150,9 +270,21 @@
  <tile id="152" terrain=",7,,"/>
  <tile id="153" terrain="7,7,,"/>
  <tile id="154" terrain="7,,,"/>
- <tile id="155" terrain=",8,,"/>
- <tile id="156" terrain="8,8,,"/>
- <tile id="157" terrain="8,,,"/>
+ <tile id="155" terrain=",8,,">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
+ <tile id="156" terrain="8,8,,">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
+ <tile id="157" terrain="8,,,">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
  <tile id="160" terrain="9,9,9,9"/>
  <tile id="161" terrain="9,9,9,9"/>
  <tile id="162" terrain="9,9,9,9"/>
@@ -168,15 +300,39 @@
  <tile id="172" terrain="3,3,3,3"/>
  <tile id="173" terrain="3,3,3,3"/>
  <tile id="174" terrain="3,3,3,3"/>
- <tile id="175" terrain="4,4,4,4"/>
- <tile id="176" terrain="4,4,4,4"/>
- <tile id="177" terrain="4,4,4,4"/>
+ <tile id="175" terrain="4,4,4,4">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
+ <tile id="176" terrain="4,4,4,4">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
+ <tile id="177" terrain="4,4,4,4">
+  <properties>
+   <property name="liquid" value="lava"/>
+  </properties>
+ </tile>
  <tile id="184" terrain="7,7,7,7"/>
  <tile id="185" terrain="7,7,7,7"/>
  <tile id="186" terrain="7,7,7,7"/>
- <tile id="187" terrain="8,8,8,8"/>
- <tile id="188" terrain="8,8,8,8"/>
- <tile id="189" terrain="8,8,8,8"/>
+ <tile id="187" terrain="8,8,8,8">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
+ <tile id="188" terrain="8,8,8,8">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
+ <tile id="189" terrain="8,8,8,8">
+  <properties>
+   <property name="liquid" value="water"/>
+  </properties>
+ </tile>
  <tile id="193" terrain="12,12,12,"/>
  <tile id="194" terrain="12,12,,12"/>
  <tile id="196" terrain="12,12,12,"/>
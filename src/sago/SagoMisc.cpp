@@ -25,8 +25,17 @@ SOFTWARE.
 #include "SagoMisc.hpp"
 #include <physfs.h>
 #include <iostream>
+#include <filesystem>
 #include <iconv.h>
 #include <string.h>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #if PHYSFS_VER_MAJOR < 3
 #define PHYSFS_readBytes(X,Y,Z) PHYSFS_read(X,Y,1,Z)
@@ -50,6 +59,16 @@ bool FileExists(const char* filename) {
 	return PHYSFS_exists(filename);
 }
 
+FileStamp GetFileStamp(const char* filename) {
+	FileStamp ret;
+	PHYSFS_Stat stat;
+	if (PHYSFS_stat(filename, &stat)) {
+		ret.modtime = stat.modtime;
+		ret.size = stat.filesize;
+	}
+	return ret;
+}
+
 void ReadBytesFromFile(const char* filename, std::unique_ptr<char[]>& dest, unsigned int& bytes) {
 	bytes = 0;
 	if (!PHYSFS_exists(filename)) {
@@ -95,22 +114,186 @@ static void CreatePathToFile(const std::string& path) {
 	PHYSFS_mkdir(path2dir.c_str());
 }
 
+static void PrintPhysfsError(const char* message) {
+#if PHYSFS_VER_MAJOR > 2
+	PHYSFS_ErrorCode code = PHYSFS_getLastErrorCode();
+	std::cerr << message << ", " << PHYSFS_getErrorByCode(code) << " (" << code << ")\n";
+#else
+	std::cerr << message << ", " << PHYSFS_getLastError() << "\n";
+#endif
+}
+
 void WriteFileContent(const char* filename, const std::string& content) {
 	CreatePathToFile(filename);
 	PHYSFS_file* myfile = PHYSFS_openWrite(filename);
 	if (!myfile) {
-#if PHYSFS_VER_MAJOR > 2
-		PHYSFS_ErrorCode code = PHYSFS_getLastErrorCode();
-		std::cerr << "Failed to open file for writing, " << PHYSFS_getErrorByCode(code) << " (" << code << ")\n";
-#else
-		std::cerr << "Failed to open file for writing, " << PHYSFS_getLastError() << "\n";
-#endif
+		PrintPhysfsError("Failed to open file for writing");
 		return;
 	}
 	PHYSFS_writeBytes(myfile, content.c_str(), sizeof(char)*content.length());
 	PHYSFS_close(myfile);
 }
 
+bool AppendFileContent(const char* filename, const std::string& content) {
+	CreatePathToFile(filename);
+	PHYSFS_file* myfile = PHYSFS_openAppend(filename);
+	if (!myfile) {
+		PrintPhysfsError("Failed to open file for appending");
+		return false;
+	}
+	bool ok = PHYSFS_writeBytes(myfile, content.c_str(), sizeof(char)*content.length()) == (PHYSFS_sint64)content.length();
+	ok = PHYSFS_close(myfile) && ok;
+	return ok;
+}
+
+bool RemoveFile(const char* filename) {
+	return PHYSFS_delete(filename);
+}
+
+bool SyncFile(const char* filename) {
+	const char* writeDir = PHYSFS_getWriteDir();
+	if (!writeDir) {
+		std::cerr << "Failed to sync " << filename << ": No write dir\n";
+		return false;
+	}
+	const std::string path = (std::filesystem::path(writeDir) / filename).string();
+#if defined(_WIN32)
+	int fd = _open(path.c_str(), _O_RDWR | _O_BINARY);
+	bool ok = fd >= 0 && _commit(fd) == 0;
+	if (fd >= 0) {
+		_close(fd);
+	}
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	bool ok = fd >= 0 && fsync(fd) == 0;
+	if (fd >= 0) {
+		close(fd);
+	}
+#endif
+	if (!ok) {
+		std::cerr << "Failed to sync " << filename << ": " << strerror(errno) << "\n";
+	}
+	return ok;
+}
+
+bool RenameFile(const char* from, const char* to) {
+	//PhysFS cannot rename, so it is done in the real write dir
+	const char* writeDir = PHYSFS_getWriteDir();
+	if (!writeDir) {
+		std::cerr << "Failed to rename " << from << ": No write dir\n";
+		return false;
+	}
+	std::error_code ec;
+	std::filesystem::rename(std::filesystem::path(writeDir) / from, std::filesystem::path(writeDir) / to, ec);
+	if (ec) {
+		std::cerr << "Failed to rename " << from << " to " << to << ": " << ec.message() << "\n";
+		return false;
+	}
+	return true;
+}
+
+class PhysfsOStream::Buffer : public std::streambuf {
+	PHYSFS_file* file = nullptr;
+	std::vector<char> data;
+	bool failed = false;
+
+	int writeBuffer() {
+		std::streamsize length = pptr()-pbase();
+		setp(data.data(), data.data()+data.size());
+		if (length > 0 && (!file || PHYSFS_writeBytes(file, data.data(), length) != length)) {
+			failed = true;
+			return -1;
+		}
+		return 0;
+	}
+public:
+	explicit Buffer(const char* filename) : data(64*1024) {
+		CreatePathToFile(filename);
+		file = PHYSFS_openWrite(filename);
+		if (!file) {
+			PrintPhysfsError("Failed to open file for writing");
+			failed = true;
+		}
+		setp(data.data(), data.data()+data.size());
+	}
+
+	~Buffer() override {
+		close();
+	}
+
+	bool close() {
+		if (file) {
+			writeBuffer();
+			if (!PHYSFS_close(file)) {
+				PrintPhysfsError("Failed to close file");
+				failed = true;
+			}
+			file = nullptr;
+		}
+		return !failed;
+	}
+
+	bool isOpen() const {
+		return file;
+	}
+protected:
+	int_type overflow(int_type ch) override {
+		if (writeBuffer() != 0) {
+			return traits_type::eof();
+		}
+		if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+			*pptr() = traits_type::to_char_type(ch);
+			pbump(1);
+		}
+		return traits_type::not_eof(ch);
+	}
+
+	std::streamsize xsputn(const char* s, std::streamsize n) override {
+		if (n <= epptr()-pptr()) {
+			memcpy(pptr(), s, n);
+			pbump(n);
+			return n;
+		}
+		if (writeBuffer() != 0) {
+			return 0;
+		}
+		if (n < static_cast<std::streamsize>(data.size())) {
+			memcpy(pptr(), s, n);
+			pbump(n);
+			return n;
+		}
+		// Larger than the buffer. No reason to copy it
+		if (!file || PHYSFS_writeBytes(file, s, n) != n) {
+			failed = true;
+			return 0;
+		}
+		return n;
+	}
+
+	int sync() override {
+		return writeBuffer();
+	}
+};
+
+PhysfsOStream::PhysfsOStream(const char* filename) : std::ostream(nullptr), buffer(new Buffer(filename)) {
+	rdbuf(buffer.get());
+	if (!buffer->isOpen()) {
+		setstate(std::ios_base::badbit);
+	}
+}
+
+PhysfsOStream::~PhysfsOStream() {
+	close();
+}
+
+bool PhysfsOStream::close() {
+	bool ok = buffer->close() && !fail();
+	if (!ok) {
+		setstate(std::ios_base::badbit);
+	}
+	return ok;
+}
+
 long int StrToLong(const char* c_string) {
 	auto ret = strtol(c_string, nullptr, 10);
 	return ret;
@@ -28,6 +28,8 @@ SOFTWARE.
 #include <vector>
 #include <string>
 #include <memory>
+#include <cstdint>
+#include <ostream>
 
 namespace sago {
 
@@ -69,8 +71,78 @@ inline std::string GetFileContent(const std::string& filename) {
 
 bool FileExists(const char* filename);
 
+/**
+ * Identifies a version of a file without reading it.
+ * If the file changes the stamp is expected to change too.
+ */
+struct FileStamp {
+	int64_t modtime = -1;
+	int64_t size = -1;
+	bool valid() const {
+		return size >= 0;
+	}
+	bool operator==(const FileStamp& other) const {
+		return modtime == other.modtime && size == other.size;
+	}
+};
+
+/**
+ * Returns the modification time and size of a file.
+ * PHYSFS must be setup before hand
+ * @param filename The file to look at
+ * @return The stamp. Not valid if the file does not exist.
+ */
+FileStamp GetFileStamp(const char* filename);
+
 void WriteFileContent(const char* filename, const std::string& content);
 
+/**
+ * Adds content to the end of a file. The file is created if it does not exist.
+ * PHYSFS must be setup before hand
+ * @return true if everything was written
+ */
+bool AppendFileContent(const char* filename, const std::string& content);
+
+/**
+ * Removes a file from the PhysFS write dir.
+ * @return true if the file was removed
+ */
+bool RemoveFile(const char* filename);
+
+/**
+ * Makes sure that the content of a file in the PhysFS write dir has reached the disk and not just the cache of the OS.
+ * @return true if the file was synced
+ */
+bool SyncFile(const char* filename);
+
+/**
+ * Renames a file in the PhysFS write dir. An existing file with the new name is replaced.
+ * Renaming a completely written temporary file over the real one means a crash never leaves a half written file behind.
+ * @return true if the file was renamed
+ */
+bool RenameFile(const char* from, const char* to);
+
+/**
+ * An output stream to a file in the PhysFS write dir.
+ * The content is buffered and written in blocks as it is produced, so a large file never has to be in memory all at once.
+ * PHYSFS must be setup before hand. If the file cannot be opened the stream starts in the bad state.
+ */
+class PhysfsOStream : public std::ostream {
+public:
+	explicit PhysfsOStream(const char* filename);
+	PhysfsOStream(const PhysfsOStream&) = delete;
+	PhysfsOStream& operator=(const PhysfsOStream&) = delete;
+	~PhysfsOStream() override;
+	/**
+	 * Writes the remaining buffer and closes the file. Also done by the destructor.
+	 * @return true if everything was written
+	 */
+	bool close();
+private:
+	class Buffer;
+	std::unique_ptr<Buffer> buffer;
+};
+
 /**
  * This functions converts a string on a best effort basis
  * Unlike atol this does NOT cause undefined behavior if out of range
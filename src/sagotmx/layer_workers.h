@@ -0,0 +1,212 @@
+/*
+A small pool of worker threads for the work on each layer of a map in tmx_struct.h and tmx_binary.h.
+The layers are independent, so decoding and compressing them is spread over the cores while the caller waits.
+
+#License
+Provided under the MIT license. The license is as follows:
+Copyright (c) 2017 Poul Sander
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef LAYER_WORKERS_H
+#define LAYER_WORKERS_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sago {
+namespace tiled {
+
+class LayerWorkers {
+public:
+	/**
+	 * The pool used by the map functions. Has one thread less than the number of cores (max 8) as the caller also works.
+	 */
+	static LayerWorkers& instance() {
+		static LayerWorkers workers(std::min(std::max(std::thread::hardware_concurrency(), 1u), 8u) - 1);
+		return workers;
+	}
+
+	explicit LayerWorkers(unsigned int threads) {
+		for (unsigned int i = 0; i < threads; ++i) {
+			this->threads.emplace_back(&LayerWorkers::work, this);
+		}
+	}
+
+	~LayerWorkers() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& t : threads) {
+			t.join();
+		}
+	}
+
+	LayerWorkers(const LayerWorkers&) = delete;
+	LayerWorkers& operator=(const LayerWorkers&) = delete;
+
+	/**
+	 * Calls task(i) for every i from 0 to count-1, spread over the workers and the calling thread. Returns when all calls are done.
+	 * If any call throws, the first exception is rethrown after all calls are done.
+	 * Calls made from inside a task are run directly by the calling thread.
+	 */
+	void run(size_t count, const std::function<void(size_t)>& task) {
+		if (count < 2 || threads.empty() || insideTask() || serialThread()) {
+			for (size_t i = 0; i < count; ++i) {
+				task(i);
+			}
+			return;
+		}
+		std::lock_guard<std::mutex> serial(runMutex);
+		Job j;
+		j.task = &task;
+		j.count = count;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = &j;
+			++generation;
+		}
+		wake.notify_all();
+		insideTask() = true;
+		process(j);
+		insideTask() = false;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [&j, this]() {
+				return j.finished == j.count && active == 0;
+			});
+			job = nullptr;
+		}
+		if (j.error) {
+			std::rethrow_exception(j.error);
+		}
+	}
+	/**
+	 * While it exists, runs made by the thread that created it are done directly by that thread. For background threads like
+	 * a save thread. Otherwise they would hold the pool while the main thread waits for it in the middle of a frame.
+	 */
+	class SerialScope {
+	public:
+		SerialScope() : previous(serialThread()) {
+			serialThread() = true;
+		}
+		~SerialScope() {
+			serialThread() = previous;
+		}
+		SerialScope(const SerialScope&) = delete;
+		SerialScope& operator=(const SerialScope&) = delete;
+	private:
+		bool previous;
+	};
+private:
+	struct Job {
+		const std::function<void(size_t)>* task = nullptr;
+		size_t count = 0;
+		std::atomic<size_t> next{0};
+		size_t finished = 0;  //< Guarded by mutex
+		std::exception_ptr error;  //< Guarded by mutex
+	};
+
+	static bool& insideTask() {
+		thread_local bool inside = false;
+		return inside;
+	}
+
+	static bool& serialThread() {
+		thread_local bool serial = false;
+		return serial;
+	}
+
+	void process(Job& j) {
+		size_t completed = 0;
+		std::exception_ptr error;
+		for (size_t i = j.next++; i < j.count; i = j.next++) {
+			try {
+				(*j.task)(i);
+			}
+			catch (...) {
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+			++completed;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		j.finished += completed;
+		if (error && !j.error) {
+			j.error = error;
+		}
+		if (j.finished == j.count) {
+			done.notify_all();
+		}
+	}
+
+	void work() {
+		insideTask() = true;
+		uint64_t seen = 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wake.wait(lock, [&seen, this]() {
+				return stopping || (job && generation != seen);
+			});
+			if (stopping) {
+				return;
+			}
+			seen = generation;
+			Job* j = job;
+			++active;
+			lock.unlock();
+			process(*j);
+			lock.lock();
+			--active;
+			done.notify_all();
+		}
+	}
+
+	std::vector<std::thread> threads;
+	std::mutex runMutex;  //< One job at a time
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	Job* job = nullptr;
+	uint64_t generation = 0;
+	int active = 0;  //< Workers that might still touch job
+	bool stopping = false;
+};
+
+/**
+ * Calls task(i) for every layer index i on the layer workers. See LayerWorkers::run
+ */
+inline void for_each_layer(size_t layer_count, const std::function<void(size_t)>& task) {
+	LayerWorkers::instance().run(layer_count, task);
+}
+
+}  //tiled
+}  //sago
+
+#endif /* LAYER_WORKERS_H */
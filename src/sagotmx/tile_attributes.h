@@ -0,0 +1,260 @@
+/*
+What a tile is, looked up by gid.
+The <tile> properties of the tilesets are compiled into a dense array when a map is loaded, so code that asks about many tiles
+does a single load per tile instead of comparing strings.
+
+Recognized tile properties:
+* blocking (bool): The tile blocks on every layer. Every tile on the layer named "blocking" blocks anyway
+* liquid (string): The kind of liquid, like "water" or "lava"
+* speed (float): Walk speed multiplier. 1.0 if not set
+* opaque (bool)
+* blocks_light (bool)
+* autotile (string): Marks the first tile of a set of tiles that are joined automatically, like "water" or "ground"
+
+Values that cannot be read are ignored. A bool is "true", "false", "1" or "0". A speed must be a number that is 0 or more.
+
+#License
+Provided under the MIT license. The license is as follows:
+Copyright (c) 2017 Poul Sander
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef TILE_ATTRIBUTES_H
+#define TILE_ATTRIBUTES_H
+
+#include "tmx_struct.h"
+#include <cmath>
+#include <cstdlib>
+
+namespace sago {
+namespace tiled {
+
+enum TileFlag : uint8_t {
+	TILE_LIQUID = 1 << 0,
+	TILE_BLOCKING = 1 << 1,
+	TILE_OPAQUE = 1 << 2,
+	TILE_BLOCKS_LIGHT = 1 << 3,
+};
+
+struct TileAttributes {
+	uint8_t flags = 0;  //< TileFlag bits
+	uint8_t liquid = 0;  //< Index in TileAttributeTable::liquids(). 0 if the tile is not a liquid
+	float speed = 1.0f;  //< Walk speed multiplier
+};
+
+class TileAttributeTable {
+public:
+	/**
+	 * Tiled stores the flip flags and the hexagonal rotation flag in the top four bits of a gid. They are ignored
+	 */
+	static constexpr uint32_t gid_mask = 0x0FFFFFFF;
+
+	/**
+	 * @return The attributes of the gid. Gids without properties have the default attributes
+	 */
+	const TileAttributes& get(uint32_t gid) const {
+		gid &= gid_mask;
+		if (gid >= attributes_.size()) {
+			return none();
+		}
+		return attributes_[gid];
+	}
+
+	bool hasFlag(uint32_t gid, TileFlag flag) const {
+		return get(gid).flags & flag;
+	}
+
+	/**
+	 * @return true if at least one gid has the flag. Lets a scan over a whole map be skipped if no tile could match
+	 */
+	bool anyHasFlag(TileFlag flag) const {
+		return usedFlags_ & flag;
+	}
+
+	void set(uint32_t gid, const TileAttributes& attributes) {
+		gid &= gid_mask;
+		if (gid >= attributes_.size()) {
+			attributes_.resize(gid+1);
+		}
+		attributes_[gid] = attributes;
+		usedFlags_ |= attributes.flags;
+	}
+
+	/**
+	 * @return The index of the liquid or 0 if no tile has it
+	 */
+	uint8_t liquidId(const std::string& name) const {
+		for (size_t i = 1; i < liquids_.size(); ++i) {
+			if (liquids_[i] == name) {
+				return i;
+			}
+		}
+		return 0;
+	}
+
+	/**
+	 * Returns the index of the liquid. The liquid is added if it is new.
+	 * Throws SagoTiledException if there are more than 255 kinds of liquid
+	 */
+	uint8_t addLiquid(const std::string& name) {
+		uint8_t ret = liquidId(name);
+		if (ret) {
+			return ret;
+		}
+		if (liquids_.size() > 255) {
+			throw SagoTiledException("Too many kinds of liquid. Cannot add \"%s\"", name.c_str());
+		}
+		liquids_.push_back(name);
+		return liquids_.size()-1;
+	}
+
+	/**
+	 * The names of the liquids. The first entry is the empty name of tiles that are not liquids
+	 */
+	const std::vector<std::string>& liquids() const {
+		return liquids_;
+	}
+
+	/**
+	 * @return The gid of the first tile of the autotile or 0 if no tile has it
+	 */
+	uint32_t autotileGid(const std::string& name) const {
+		const auto itr = autotiles_.find(name);
+		if (itr == autotiles_.end()) {
+			return 0;
+		}
+		return itr->second;
+	}
+
+	void setAutotileGid(const std::string& name, uint32_t gid) {
+		autotiles_[name] = gid & gid_mask;
+	}
+
+	/**
+	 * @return One more than the largest gid with attributes
+	 */
+	size_t size() const {
+		return attributes_.size();
+	}
+
+	void clear() {
+		attributes_.clear();
+		usedFlags_ = 0;
+		liquids_.assign(1, "");
+		autotiles_.clear();
+	}
+
+private:
+	static const TileAttributes& none() {
+		static const TileAttributes attributes;
+		return attributes;
+	}
+
+	std::vector<TileAttributes> attributes_;
+	uint8_t usedFlags_ = 0;  //< All the flags of attributes_ or'ed together
+	std::vector<std::string> liquids_ = {""};
+	std::map<std::string, uint32_t> autotiles_;
+};
+
+/**
+ * Reads a bool tile property.
+ * @return true if the property is "true" or "1". The default value if the property is missing or cannot be read
+ */
+inline bool readTilePropertyBool(const std::map<std::string, TileProperty>& properties, const char* name, bool default_value) {
+	const auto itr = properties.find(name);
+	if (itr == properties.end()) {
+		return default_value;
+	}
+	const std::string& value = itr->second.value;
+	if (value == "true" || value == "1") {
+		return true;
+	}
+	if (value == "false" || value == "0") {
+		return false;
+	}
+	return default_value;
+}
+
+/**
+ * Reads a float tile property without throwing.
+ * @return The value or the default value if the property is missing or is not a number
+ */
+inline float readTilePropertyFloat(const std::map<std::string, TileProperty>& properties, const char* name, float default_value) {
+	const auto itr = properties.find(name);
+	if (itr == properties.end()) {
+		return default_value;
+	}
+	const char* value = itr->second.value.c_str();
+	char* end = nullptr;
+	const float ret = std::strtof(value, &end);
+	if (end == value || *end != '\0' || !std::isfinite(ret)) {
+		return default_value;
+	}
+	return ret;
+}
+
+/**
+ * Compiles the tile properties of all tilesets in the map. External tilesets must already be injected as alternativeSource.
+ * @param tm The map
+ * @return The attributes indexed by gid
+ */
+inline TileAttributeTable buildTileAttributes(const TileMap& tm) {
+	TileAttributeTable ret;
+	for (const TileSet& map_tileset : tm.tileset) {
+		const TileSet* ts = &map_tileset;
+		while (ts->alternativeSource) {
+			ts = ts->alternativeSource;
+		}
+		for (const Tile& tile : ts->tiles) {
+			if (tile.properties.empty()) {
+				continue;
+			}
+			TileAttributes attributes;
+			if (readTilePropertyBool(tile.properties, "blocking", false)) {
+				attributes.flags |= TILE_BLOCKING;
+			}
+			if (readTilePropertyBool(tile.properties, "opaque", false)) {
+				attributes.flags |= TILE_OPAQUE;
+			}
+			if (readTilePropertyBool(tile.properties, "blocks_light", false)) {
+				attributes.flags |= TILE_BLOCKS_LIGHT;
+			}
+			attributes.speed = readTilePropertyFloat(tile.properties, "speed", 1.0f);
+			if (attributes.speed < 0.0f) {
+				attributes.speed = 1.0f;
+			}
+			const auto liquid = tile.properties.find("liquid");
+			if (liquid != tile.properties.end() && liquid->second.value.length()) {
+				attributes.flags |= TILE_LIQUID;
+				attributes.liquid = ret.addLiquid(liquid->second.value);
+			}
+			const auto autotile = tile.properties.find("autotile");
+			if (autotile != tile.properties.end() && autotile->second.value.length()) {
+				ret.setAutotileGid(autotile->second.value, map_tileset.firstgid+tile.id);
+			}
+			ret.set(map_tileset.firstgid+tile.id, attributes);
+		}
+	}
+	return ret;
+}
+
+}  //tiled
+}  //sago
+
+#endif /* TILE_ATTRIBUTES_H */
@@ -0,0 +1,497 @@
+/*
+Tile storage for the layers of a TileMap.
+The tiles are stored as uint32 gids in chunks of 16x16 tiles. Most layers are almost entirely empty, so all empty chunks
+share a single sentinel chunk and take no memory of their own. Chunks are shared between copies of a grid until one of them is
+changed.
+
+#License
+Provided under the MIT license. The license is as follows:
+Copyright (c) 2017 Poul Sander
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef TILE_GRID_H
+#define TILE_GRID_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "TileGrid::copyTo and TileGrid::assign are used directly for the little-endian layer data of the map formats"
+#endif
+
+namespace sago {
+namespace tiled {
+
+struct alignas(32) TileChunk {
+	static constexpr int size = 16;
+	uint32_t tiles[size*size] = {};
+	int nonZero = 0;  //< Number of tiles that are not 0
+};
+
+class TileGrid {
+public:
+	TileGrid() = default;
+
+	TileGrid(int width, int height, uint32_t tile = 0) {
+		resize(width, height, tile);
+	}
+
+	/**
+	 * Changes the size. The content is lost and every tile is set to tile.
+	 */
+	void resize(int width, int height, uint32_t tile = 0) {
+		width_ = std::max(width, 0);
+		height_ = std::max(height, 0);
+		chunksX_ = (width_+TileChunk::size-1)/TileChunk::size;
+		chunksY_ = (height_+TileChunk::size-1)/TileChunk::size;
+		chunks_.assign(static_cast<size_t>(chunksX_)*chunksY_, emptyChunk());
+		touch();
+		if (tile) {
+			fill(tile);
+		}
+	}
+
+	int width() const {
+		return width_;
+	}
+
+	int height() const {
+		return height_;
+	}
+
+	/**
+	 * @return Number of tiles
+	 */
+	size_t size() const {
+		return static_cast<size_t>(width_)*height_;
+	}
+
+	bool inBounds(int x, int y) const {
+		return x >= 0 && y >= 0 && x < width_ && y < height_;
+	}
+
+	/**
+	 * @return The tile at (x,y) or 0 if outside the grid
+	 */
+	uint32_t get(int x, int y) const {
+		if (!inBounds(x, y)) {
+			return 0;
+		}
+		return chunkAt(x, y).tiles[localIndex(x, y)];
+	}
+
+	/**
+	 * Sets the tile at (x,y).
+	 * @return false if (x,y) is outside the grid. Nothing is changed in that case
+	 */
+	bool set(int x, int y, uint32_t tile) {
+		if (!inBounds(x, y)) {
+			return false;
+		}
+		writeRow(x, y, 1, &tile);
+		touch();
+		return true;
+	}
+
+	/**
+	 * Copies all tiles to dest in rows of width tiles. Only chunks with tiles are visited.
+	 * @param dest Room for size() tiles
+	 */
+	void copyTo(uint32_t* dest) const {
+		std::fill(dest, dest+size(), 0);
+		forEachChunk([&](int x, int y, int w, int h, const TileChunk& chunk) {
+			for (int j = 0; j < h; ++j) {
+				std::copy_n(&chunk.tiles[j*TileChunk::size], w, &dest[static_cast<size_t>(y+j)*width_+x]);
+			}
+		});
+	}
+
+	/**
+	 * Replaces all tiles with the ones in source. Chunks without tiles take no memory.
+	 * @param source size() tiles in rows of width tiles
+	 */
+	void assign(const uint32_t* source) {
+		for (int y = 0; y < height_; ++y) {
+			writeRow(0, y, width_, &source[static_cast<size_t>(y)*width_]);
+		}
+		touch();
+	}
+
+	/**
+	 * Copies a rectangle to dest in rows of w tiles. Tiles outside the grid are written as 0.
+	 * @param dest Room for w*h tiles
+	 */
+	void copyRectTo(int x, int y, int w, int h, uint32_t* dest) const {
+		std::fill(dest, dest+static_cast<size_t>(w)*h, 0);
+		const int left = x;
+		const int top = y;
+		const int stride = w;
+		if (!clip(x, y, w, h)) {
+			return;
+		}
+		for (int j = 0; j < h; ++j) {
+			readRow(x, y+j, w, &dest[static_cast<size_t>(y-top+j)*stride+(x-left)]);
+		}
+	}
+
+	/**
+	 * Replaces the tiles of a rectangle with the ones in source. The rectangle is clipped to the grid.
+	 * @param source w*h tiles in rows of w tiles
+	 */
+	void assignRect(int x, int y, int w, int h, const uint32_t* source) {
+		const int left = x;
+		const int top = y;
+		const int stride = w;
+		if (!clip(x, y, w, h)) {
+			return;
+		}
+		for (int j = 0; j < h; ++j) {
+			writeRow(x, y+j, w, &source[static_cast<size_t>(y-top+j)*stride+(x-left)]);
+		}
+		touch();
+	}
+
+	void fill(uint32_t tile) {
+		fillRect(0, 0, width_, height_, tile);
+	}
+
+	/**
+	 * Sets every tile in the rectangle. The rectangle is clipped to the grid.
+	 */
+	void fillRect(int x, int y, int w, int h, uint32_t tile) {
+		if (!clip(x, y, w, h)) {
+			return;
+		}
+		std::vector<uint32_t> row(w, tile);
+		for (int j = y; j < y+h; ++j) {
+			writeRow(x, j, w, row.data());
+		}
+		touch();
+	}
+
+	/**
+	 * Copies a rectangle from source to (destX, destY) in this grid.
+	 * The rectangle is clipped to both grids. source may be this grid.
+	 */
+	void copyRect(const TileGrid& source, int sourceX, int sourceY, int w, int h, int destX, int destY) {
+		copyRect(source, sourceX, sourceY, w, h, destX, destY, [](uint32_t tile) {
+			return tile;
+		});
+	}
+
+	/**
+	 * Like copyRect but every tile is passed through transform on the way.
+	 */
+	template <class Transform>
+	void copyRect(const TileGrid& source, int sourceX, int sourceY, int w, int h, int destX, int destY, Transform transform) {
+		if (&source == this) {
+			TileGrid copy = source;  //Only shares the chunks
+			copyRect(copy, sourceX, sourceY, w, h, destX, destY, transform);
+			return;
+		}
+		if (!clipCopy(source, sourceX, sourceY, w, h, destX, destY)) {
+			return;
+		}
+		std::vector<uint32_t> row(w);
+		for (int j = 0; j < h; ++j) {
+			source.readRow(sourceX, sourceY+j, w, row.data());
+			std::transform(row.begin(), row.end(), row.begin(), transform);
+			writeRow(destX, destY+j, w, row.data());
+		}
+		touch();
+	}
+
+	/**
+	 * Compares the rectangle at (x, y) in both grids.
+	 * The rectangle is clipped to both grids.
+	 * @return true if all tiles are the same
+	 */
+	bool compareRect(const TileGrid& other, int x, int y, int w, int h) const {
+		if (!clip(x, y, w, h) || !other.clip(x, y, w, h)) {
+			return true;
+		}
+		std::vector<uint32_t> a(w);
+		std::vector<uint32_t> b(w);
+		for (int j = y; j < y+h; ++j) {
+			readRow(x, j, w, a.data());
+			other.readRow(x, j, w, b.data());
+			if (a != b) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t countNonZero() const {
+		size_t ret = 0;
+		for (const std::shared_ptr<TileChunk>& chunk : chunks_) {
+			ret += chunk->nonZero;
+		}
+		return ret;
+	}
+
+	/**
+	 * Counts the tiles that are not 0 in the rectangle. The rectangle is clipped to the grid.
+	 */
+	size_t countNonZero(int x, int y, int w, int h) const {
+		size_t ret = 0;
+		forEachNonZero(x, y, w, h, [&ret](int, int, uint32_t) {
+			++ret;
+		});
+		return ret;
+	}
+
+	/**
+	 * Calls func(x, y, tile) for every tile in the rectangle that is not 0. Empty chunks are skipped without looking at their tiles.
+	 * The tiles are visited chunk by chunk. The rectangle is clipped to the grid.
+	 */
+	template <class Func>
+	void forEachNonZero(int x, int y, int w, int h, Func func) const {
+		if (!clip(x, y, w, h)) {
+			return;
+		}
+		for (int cy = y/TileChunk::size; cy <= (y+h-1)/TileChunk::size; ++cy) {
+			for (int cx = x/TileChunk::size; cx <= (x+w-1)/TileChunk::size; ++cx) {
+				const TileChunk& chunk = *chunks_[static_cast<size_t>(cy)*chunksX_+cx];
+				if (chunk.nonZero == 0) {
+					continue;
+				}
+				const int startX = std::max(x, cx*TileChunk::size);
+				const int endX = std::min(x+w, (cx+1)*TileChunk::size);
+				const int startY = std::max(y, cy*TileChunk::size);
+				const int endY = std::min(y+h, (cy+1)*TileChunk::size);
+				for (int j = startY; j < endY; ++j) {
+					const uint32_t* row = &chunk.tiles[(j-cy*TileChunk::size)*TileChunk::size];
+					for (int i = startX; i < endX; ++i) {
+						const uint32_t tile = row[i-cx*TileChunk::size];
+						if (tile) {
+							func(i, j, tile);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	template <class Func>
+	void forEachNonZero(Func func) const {
+		forEachNonZero(0, 0, width_, height_, func);
+	}
+
+	/**
+	 * Calls func(x, y, old_tile, new_tile) for every tile that differs from older, which must have the same size.
+	 * Chunks that are still shared with older are skipped without being read, so comparing with a copy taken earlier only
+	 * costs time for the chunks that have been written to since.
+	 */
+	template <class Func>
+	void forEachChange(const TileGrid& older, Func func) const {
+		for (int cy = 0; cy < chunksY_; ++cy) {
+			for (int cx = 0; cx < chunksX_; ++cx) {
+				const size_t index = static_cast<size_t>(cy)*chunksX_+cx;
+				if (chunks_[index] == older.chunks_[index]) {
+					continue;
+				}
+				const TileChunk& chunk = *chunks_[index];
+				const TileChunk& old_chunk = *older.chunks_[index];
+				const int startX = cx*TileChunk::size;
+				const int startY = cy*TileChunk::size;
+				const int endX = std::min(startX+TileChunk::size, width_);
+				const int endY = std::min(startY+TileChunk::size, height_);
+				for (int j = startY; j < endY; ++j) {
+					for (int i = startX; i < endX; ++i) {
+						const int local = localIndex(i, j);
+						if (chunk.tiles[local] != old_chunk.tiles[local]) {
+							func(i, j, old_chunk.tiles[local], chunk.tiles[local]);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * Number of chunks that have at least one tile. The rest take no memory.
+	 */
+	size_t nonEmptyChunks() const {
+		return std::count_if(chunks_.begin(), chunks_.end(), [](const std::shared_ptr<TileChunk>& chunk) {
+			return chunk->nonZero > 0;
+		});
+	}
+
+	/**
+	 * A number that changes whenever this grid is modified. Copies start with the same value as the grid they were copied from.
+	 * Used to tell if data derived from the grid is still valid.
+	 */
+	uint64_t revision() const {
+		return revision_;
+	}
+
+	bool operator==(const TileGrid& other) const {
+		if (width_ != other.width_ || height_ != other.height_) {
+			return false;
+		}
+		for (size_t i = 0; i < chunks_.size(); ++i) {
+			if (chunks_[i] != other.chunks_[i] && !std::equal(std::begin(chunks_[i]->tiles), std::end(chunks_[i]->tiles), other.chunks_[i]->tiles)) {
+				return false;
+			}
+		}
+		return true;
+	}
+private:
+	static const std::shared_ptr<TileChunk>& emptyChunk() {
+		static const std::shared_ptr<TileChunk> empty = std::make_shared<TileChunk>();
+		return empty;
+	}
+
+	static int localIndex(int x, int y) {
+		return (y%TileChunk::size)*TileChunk::size+x%TileChunk::size;
+	}
+
+	std::shared_ptr<TileChunk>& chunkSlot(int x, int y) {
+		return chunks_[static_cast<size_t>(y/TileChunk::size)*chunksX_+x/TileChunk::size];
+	}
+
+	const TileChunk& chunkAt(int x, int y) const {
+		return *chunks_[static_cast<size_t>(y/TileChunk::size)*chunksX_+x/TileChunk::size];
+	}
+
+	/**
+	 * Calls func(x, y, width, height, chunk) for every chunk with tiles. x, y, width and height is the part of the grid it covers.
+	 */
+	template <class Func>
+	void forEachChunk(Func func) const {
+		for (int cy = 0; cy < chunksY_; ++cy) {
+			for (int cx = 0; cx < chunksX_; ++cx) {
+				const TileChunk& chunk = *chunks_[static_cast<size_t>(cy)*chunksX_+cx];
+				if (chunk.nonZero == 0) {
+					continue;
+				}
+				const int x = cx*TileChunk::size;
+				const int y = cy*TileChunk::size;
+				func(x, y, std::min(TileChunk::size, width_-x), std::min(TileChunk::size, height_-y), chunk);
+			}
+		}
+	}
+
+	/**
+	 * Reads count tiles starting at (x,y). The tiles must be inside the grid.
+	 */
+	void readRow(int x, int y, int count, uint32_t* dest) const {
+		while (count > 0) {
+			const int n = std::min(count, TileChunk::size-x%TileChunk::size);
+			std::copy_n(&chunkAt(x, y).tiles[localIndex(x, y)], n, dest);
+			x += n;
+			dest += n;
+			count -= n;
+		}
+	}
+
+	/**
+	 * Writes count tiles starting at (x,y). The tiles must be inside the grid.
+	 * Keeps the non zero counts up to date. Chunks are only allocated or copied if tiles are actually written to them and
+	 * chunks that become empty are replaced by the sentinel.
+	 */
+	void writeRow(int x, int y, int count, const uint32_t* source) {
+		while (count > 0) {
+			const int n = std::min(count, TileChunk::size-x%TileChunk::size);
+			std::shared_ptr<TileChunk>& slot = chunkSlot(x, y);
+			uint32_t* dest = &slot->tiles[localIndex(x, y)];
+			const int added = countNonZero(source, n);
+			if (!std::equal(source, source+n, dest)) {
+				if (slot.use_count() > 1) {
+					slot = std::make_shared<TileChunk>(*slot);  //Shared with another grid or the empty sentinel
+					dest = &slot->tiles[localIndex(x, y)];
+				}
+				slot->nonZero += added-countNonZero(dest, n);
+				std::copy_n(source, n, dest);
+				if (slot->nonZero == 0) {
+					slot = emptyChunk();
+				}
+			}
+			x += n;
+			source += n;
+			count -= n;
+		}
+	}
+
+	static int countNonZero(const uint32_t* tiles, int count) {
+		int ret = 0;
+		for (int i = 0; i < count; ++i) {
+			ret += tiles[i] != 0;
+		}
+		return ret;
+	}
+
+	/**
+	 * Clips the rectangle to the grid.
+	 * @return false if nothing is left
+	 */
+	bool clip(int& x, int& y, int& w, int& h) const {
+		if (x < 0) {
+			w += x;
+			x = 0;
+		}
+		if (y < 0) {
+			h += y;
+			y = 0;
+		}
+		w = std::min(w, width_-x);
+		h = std::min(h, height_-y);
+		return w > 0 && h > 0;
+	}
+
+	bool clipCopy(const TileGrid& source, int& sourceX, int& sourceY, int& w, int& h, int& destX, int& destY) const {
+		int shift = std::max(-sourceX, -destX);
+		if (shift > 0) {
+			sourceX += shift;
+			destX += shift;
+			w -= shift;
+		}
+		shift = std::max(-sourceY, -destY);
+		if (shift > 0) {
+			sourceY += shift;
+			destY += shift;
+			h -= shift;
+		}
+		w = std::min({w, source.width_-sourceX, width_-destX});
+		h = std::min({h, source.height_-sourceY, height_-destY});
+		return w > 0 && h > 0;
+	}
+
+	void touch() {
+		static std::atomic<uint64_t> counter(0);
+		revision_ = ++counter;
+	}
+
+	int width_ = 0;
+	int height_ = 0;
+	int chunksX_ = 0;
+	int chunksY_ = 0;
+	std::vector<std::shared_ptr<TileChunk> > chunks_;  //< Row by row. Empty chunks point to emptyChunk()
+	uint64_t revision_ = 0;
+};
+
+}  //tiled
+}  //sago
+
+#endif /* TILE_GRID_H */
@@ -0,0 +1,351 @@
+/*
+Base64 encoding and decoding of layer data for tmx_struct.h
+Table driven with SSSE3 and AVX2 versions for x86. The fastest version supported by the CPU is chosen at runtime.
+Works directly on memory. Define SAGOTMX_BASE64_NO_SIMD to only use the portable version.
+
+#License
+Provided under the MIT license. The license is as follows:
+Copyright (c) 2017 Poul Sander
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef TMX_BASE64_H
+#define TMX_BASE64_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if !defined(SAGOTMX_BASE64_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SAGOTMX_BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+namespace sago {
+namespace tiled {
+
+const char base64_alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+/**
+ * Maps a character to its 6 bit value. Everything that is not in the alphabet (whitespace, padding) maps to 0xFF
+ */
+struct Base64DecodeTable {
+	uint8_t value[256];
+
+	constexpr Base64DecodeTable() : value() {
+		for (int i = 0; i < 256; ++i) {
+			value[i] = 0xFF;
+		}
+		for (int i = 0; i < 64; ++i) {
+			value[static_cast<unsigned char>(base64_alphabet[i])] = i;
+		}
+	}
+};
+
+inline constexpr Base64DecodeTable base64_decode_table;
+
+/**
+ * Encodes all complete groups of 3 bytes.
+ * @return Number of bytes consumed. Number of characters written is 4/3 of that
+ */
+inline size_t base64_encode_groups_scalar(const unsigned char* data, size_t length, char* out) {
+	size_t done = 0;
+	for (; length - done >= 3; done += 3) {
+		const uint32_t bits = data[done] << 16 | data[done+1] << 8 | data[done+2];
+		out[0] = base64_alphabet[bits >> 18];
+		out[1] = base64_alphabet[(bits >> 12) & 0x3F];
+		out[2] = base64_alphabet[(bits >> 6) & 0x3F];
+		out[3] = base64_alphabet[bits & 0x3F];
+		out += 4;
+	}
+	return done;
+}
+
+/**
+ * Decodes groups of 4 characters until the end or until a group has a character that is not in the alphabet.
+ * @return Number of characters consumed. Number of bytes written is 3/4 of that
+ */
+inline size_t base64_decode_groups_scalar(const unsigned char* code, size_t length, char* out) {
+	size_t done = 0;
+	for (; length - done >= 4; done += 4) {
+		const uint32_t a = base64_decode_table.value[code[done]];
+		const uint32_t b = base64_decode_table.value[code[done+1]];
+		const uint32_t c = base64_decode_table.value[code[done+2]];
+		const uint32_t d = base64_decode_table.value[code[done+3]];
+		if ((a | b | c | d) > 63) {
+			break;
+		}
+		const uint32_t bits = a << 18 | b << 12 | c << 6 | d;
+		out[0] = bits >> 16;
+		out[1] = bits >> 8;
+		out[2] = bits;
+		out += 3;
+	}
+	return done;
+}
+
+#if SAGOTMX_BASE64_X86
+
+/*
+ * The SIMD versions work on 16 or 32 characters (12 or 24 bytes) at a time.
+ * Encoding spreads each 3 bytes over 4 bytes of 6 bits and turns the values into characters with a 16 entry table of offsets.
+ * Decoding compares against the character ranges of the alphabet to find the offsets, then packs the 6 bit values with multiply-add.
+ * A block with any character outside the alphabet is left to the scalar code.
+ */
+
+__attribute__((target("ssse3")))
+inline __m128i base64_encode_block_ssse3(__m128i in) {
+	in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+	const __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+	const __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+	const __m128i indices = _mm_or_si128(t0, t1);
+	__m128i offset_index = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+	const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+	offset_index = _mm_or_si128(offset_index, _mm_and_si128(upper, _mm_set1_epi8(13)));
+	const __m128i offsets = _mm_setr_epi8('a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52,
+	                                      '+'-62, '/'-63, 'A', 0, 0);
+	return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, offset_index));
+}
+
+__attribute__((target("ssse3")))
+inline size_t base64_encode_groups_ssse3(const unsigned char* data, size_t length, char* out) {
+	size_t done = 0;
+	//Reads 16 bytes to use 12
+	for (; length - done >= 16; done += 12) {
+		const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data+done));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out), base64_encode_block_ssse3(in));
+		out += 16;
+	}
+	return done + base64_encode_groups_scalar(data+done, length-done, out);
+}
+
+__attribute__((target("avx2")))
+inline size_t base64_encode_groups_avx2(const unsigned char* data, size_t length, char* out) {
+	size_t done = 0;
+	const __m256i shuffle = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+	                                         1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+	const __m256i offsets = _mm256_setr_epi8('a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52,
+	                                         '+'-62, '/'-63, 'A', 0, 0,
+	                                         'a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52,
+	                                         '+'-62, '/'-63, 'A', 0, 0);
+	//Reads 28 bytes to use 24
+	for (; length - done >= 32; done += 24) {
+		const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data+done));
+		const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data+done+12));
+		__m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+		in = _mm256_shuffle_epi8(in, shuffle);
+		const __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+		const __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+		const __m256i indices = _mm256_or_si256(t0, t1);
+		__m256i offset_index = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+		const __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+		offset_index = _mm256_or_si256(offset_index, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+		const __m256i result = _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, offset_index));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), result);
+		out += 32;
+	}
+	return done + base64_encode_groups_ssse3(data+done, length-done, out);
+}
+
+__attribute__((target("ssse3")))
+inline __m128i base64_in_range_ssse3(__m128i in, char first, char last) {
+	return _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8(first-1)), _mm_cmplt_epi8(in, _mm_set1_epi8(last+1)));
+}
+
+__attribute__((target("ssse3")))
+inline size_t base64_decode_groups_ssse3(const unsigned char* code, size_t length, char* out) {
+	size_t done = 0;
+	for (; length - done >= 16; done += 16) {
+		const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(code+done));
+		const __m128i upper = base64_in_range_ssse3(in, 'A', 'Z');
+		const __m128i lower = base64_in_range_ssse3(in, 'a', 'z');
+		const __m128i digit = base64_in_range_ssse3(in, '0', '9');
+		const __m128i plus = _mm_cmpeq_epi8(in, _mm_set1_epi8('+'));
+		const __m128i slash = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+		const __m128i valid = _mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, plus)), slash);
+		if (_mm_movemask_epi8(valid) != 0xFFFF) {
+			break;
+		}
+		__m128i offset = _mm_and_si128(upper, _mm_set1_epi8(-65));
+		offset = _mm_or_si128(offset, _mm_and_si128(lower, _mm_set1_epi8(-71)));
+		offset = _mm_or_si128(offset, _mm_and_si128(digit, _mm_set1_epi8(4)));
+		offset = _mm_or_si128(offset, _mm_and_si128(plus, _mm_set1_epi8(19)));
+		offset = _mm_or_si128(offset, _mm_and_si128(slash, _mm_set1_epi8(16)));
+		__m128i values = _mm_add_epi8(in, offset);
+		values = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+		values = _mm_madd_epi16(values, _mm_set1_epi32(0x00011000));
+		values = _mm_shuffle_epi8(values, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+		char block[16];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(block), values);
+		memcpy(out, block, 12);
+		out += 12;
+	}
+	return done + base64_decode_groups_scalar(code+done, length-done, out);
+}
+
+__attribute__((target("avx2")))
+inline __m256i base64_in_range_avx2(__m256i in, char first, char last) {
+	return _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8(first-1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(last+1), in));
+}
+
+__attribute__((target("avx2")))
+inline size_t base64_decode_groups_avx2(const unsigned char* code, size_t length, char* out) {
+	size_t done = 0;
+	const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+	                                      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	for (; length - done >= 32; done += 32) {
+		const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(code+done));
+		const __m256i upper = base64_in_range_avx2(in, 'A', 'Z');
+		const __m256i lower = base64_in_range_avx2(in, 'a', 'z');
+		const __m256i digit = base64_in_range_avx2(in, '0', '9');
+		const __m256i plus = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('+'));
+		const __m256i slash = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+		const __m256i valid = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, plus)), slash);
+		if (_mm256_movemask_epi8(valid) != -1) {
+			break;
+		}
+		__m256i offset = _mm256_and_si256(upper, _mm256_set1_epi8(-65));
+		offset = _mm256_or_si256(offset, _mm256_and_si256(lower, _mm256_set1_epi8(-71)));
+		offset = _mm256_or_si256(offset, _mm256_and_si256(digit, _mm256_set1_epi8(4)));
+		offset = _mm256_or_si256(offset, _mm256_and_si256(plus, _mm256_set1_epi8(19)));
+		offset = _mm256_or_si256(offset, _mm256_and_si256(slash, _mm256_set1_epi8(16)));
+		__m256i values = _mm256_add_epi8(in, offset);
+		values = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+		values = _mm256_madd_epi16(values, _mm256_set1_epi32(0x00011000));
+		values = _mm256_shuffle_epi8(values, pack);
+		values = _mm256_permutevar8x32_epi32(values, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+		char block[32];
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(block), values);
+		memcpy(out, block, 24);
+		out += 24;
+	}
+	return done + base64_decode_groups_ssse3(code+done, length-done, out);
+}
+
+#endif  //SAGOTMX_BASE64_X86
+
+struct Base64Kernels {
+	size_t (*encode)(const unsigned char* data, size_t length, char* out);
+	size_t (*decode)(const unsigned char* code, size_t length, char* out);
+};
+
+/**
+ * The fastest implementation the CPU supports. Chosen on first use.
+ */
+inline const Base64Kernels& base64_kernels() {
+	static const Base64Kernels kernels = [] {
+#if SAGOTMX_BASE64_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) {
+			return Base64Kernels{base64_encode_groups_avx2, base64_decode_groups_avx2};
+		}
+		if (__builtin_cpu_supports("ssse3")) {
+			return Base64Kernels{base64_encode_groups_ssse3, base64_decode_groups_ssse3};
+		}
+#endif
+		return Base64Kernels{base64_encode_groups_scalar, base64_decode_groups_scalar};
+	}();
+	return kernels;
+}
+
+/**
+ * @return The exact number of characters base64_encode writes for length bytes
+ */
+inline size_t base64_encoded_length(size_t length) {
+	return (length+2)/3*4;
+}
+
+/**
+ * @return The maximum number of bytes base64_decode writes for length characters
+ */
+inline size_t base64_decoded_max_length(size_t length) {
+	return length/4*3+3;
+}
+
+/**
+ * Base64 encodes data with padding and without line breaks.
+ * @param out Room for base64_encoded_length(length) characters. Not null terminated
+ * @return Number of characters written
+ */
+inline size_t base64_encode(const char* data, size_t length, char* out) {
+	const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+	const size_t done = base64_kernels().encode(in, length, out);
+	char* pos = out + done/3*4;
+	const size_t left = length - done;
+	if (left > 0) {
+		const uint32_t bits = in[done] << 16 | (left > 1 ? in[done+1] << 8 : 0);
+		pos[0] = base64_alphabet[bits >> 18];
+		pos[1] = base64_alphabet[(bits >> 12) & 0x3F];
+		pos[2] = left > 1 ? base64_alphabet[(bits >> 6) & 0x3F] : '=';
+		pos[3] = '=';
+		pos += 4;
+	}
+	return pos - out;
+}
+
+/**
+ * Decodes base64. Whitespace, padding and any other character outside the alphabet is skipped, so the text of a
+ * TMX <data> node can be given directly.
+ * @param out Room for base64_decoded_max_length(length) bytes
+ * @return Number of bytes written
+ */
+inline size_t base64_decode(const char* code, size_t length, char* out) {
+	const unsigned char* in = reinterpret_cast<const unsigned char*>(code);
+	const unsigned char* end = in + length;
+	const Base64Kernels& kernels = base64_kernels();
+	char* pos = out;
+	uint32_t bits = 0;
+	int pending = 0;
+	while (in < end) {
+		if (pending == 0) {
+			const size_t done = kernels.decode(in, end-in, pos);
+			in += done;
+			pos += done/4*3;
+			if (in == end) {
+				break;
+			}
+		}
+		const uint32_t value = base64_decode_table.value[*in++];
+		if (value > 63) {
+			continue;
+		}
+		bits = bits << 6 | value;
+		if (++pending == 4) {
+			pos[0] = bits >> 16;
+			pos[1] = bits >> 8;
+			pos[2] = bits;
+			pos += 3;
+			bits = 0;
+			pending = 0;
+		}
+	}
+	if (pending == 2) {
+		*pos++ = bits >> 4;
+	}
+	else if (pending == 3) {
+		*pos++ = bits >> 10;
+		*pos++ = bits >> 2;
+	}
+	return pos - out;
+}
+
+}  //tiled
+}  //sago
+
+#endif /* TMX_BASE64_H */
@@ -0,0 +1,599 @@
+/*
+This is an extension to tmx_struct.h that stores a TileMap in a flat binary format.
+The format is meant for maps that are only read and written by the engine itself. Use the TMX functions for anything that must be opened in Tiled.
+
+Layout (all integers are little-endian):
+* Header: magic "STMB", uint32 version
+* Map attributes, map properties and tilesets
+* Layer table: name, width, height, encoding, compression and the offset and size of the layer data in the file
+* Object section: object groups with their objects. Numbers are stored as variable length integers
+* Layer data: uint32 gids compressed with the compression of the layer. Uncompressed each layer is width*height*4 bytes.
+  A layer without any tiles has no data (size 0)
+
+Version 1 files had no encoding, compression or compression level and stored the layers uncompressed.
+Version 2 files stored empty layers like any other layer.
+Version 4 and older files did not store the terrains and the tiles (with their properties) of embedded tilesets.
+All of them can still be read.
+
+#License
+Provided under the MIT license. The license is as follows:
+Copyright (c) 2017 Poul Sander
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef TMX_BINARY_H
+#define TMX_BINARY_H
+
+#include "tmx_struct.h"
+#include <chrono>
+
+namespace sago {
+namespace tiled {
+
+const char binary_magic[4] = {'S', 'T', 'M', 'B'};
+const uint32_t binary_version = 5;
+
+class BinaryWriter {
+	std::string& out;
+public:
+	explicit BinaryWriter(std::string& output) : out(output) {}
+
+	size_t position() const {
+		return out.size();
+	}
+
+	void write_bytes(const char* data, size_t length) {
+		out.append(data, length);
+	}
+
+	void write_u32(uint32_t value) {
+		char buffer[4];
+		buffer[0] = value & 0xFF;
+		buffer[1] = (value >> 8) & 0xFF;
+		buffer[2] = (value >> 16) & 0xFF;
+		buffer[3] = (value >> 24) & 0xFF;
+		out.append(buffer, sizeof(buffer));
+	}
+
+	/**
+	 * Overwrites an uint32 that has already been written. Used for offsets that are not known until later.
+	 */
+	void patch_u32(size_t pos, uint32_t value) {
+		out[pos] = value & 0xFF;
+		out[pos+1] = (value >> 8) & 0xFF;
+		out[pos+2] = (value >> 16) & 0xFF;
+		out[pos+3] = (value >> 24) & 0xFF;
+	}
+
+	void write_varuint(uint64_t value) {
+		while (value >= 0x80) {
+			out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<char>(value));
+	}
+
+	void write_varint(int64_t value) {
+		//zigzag encoding so small negative numbers are also small
+		write_varuint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+	}
+
+	void write_double(double value) {
+		uint64_t bits = 0;
+		memcpy(&bits, &value, sizeof(bits));
+		write_u32(bits & 0xFFFFFFFF);
+		write_u32(bits >> 32);
+	}
+
+	void write_string(const std::string& value) {
+		write_varuint(value.size());
+		out.append(value);
+	}
+};
+
+class BinaryReader {
+	const char* data;
+	size_t size;
+	size_t pos = 0;
+
+	void require(size_t length) const {
+		if (length > size || pos > size - length) {
+			throw SagoTiledException("Binary map truncated. Needed %lu bytes at position %lu of %lu", (unsigned long)length, (unsigned long)pos, (unsigned long)size);
+		}
+	}
+public:
+	BinaryReader(const char* data, size_t size) : data(data), size(size) {}
+
+	size_t position() const {
+		return pos;
+	}
+
+	const char* read_bytes(size_t length) {
+		require(length);
+		const char* ret = data+pos;
+		pos += length;
+		return ret;
+	}
+
+	/**
+	 * Returns a pointer to a region anywhere in the buffer without moving the read position.
+	 */
+	const char* bytes_at(size_t offset, size_t length) const {
+		if (length > size || offset > size - length) {
+			throw SagoTiledException("Binary map truncated. Block at %lu with %lu bytes is outside the %lu bytes file", (unsigned long)offset, (unsigned long)length, (unsigned long)size);
+		}
+		return data+offset;
+	}
+
+	uint32_t read_u32() {
+		const unsigned char* p = reinterpret_cast<const unsigned char*>(read_bytes(4));
+		return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24;
+	}
+
+	uint64_t read_varuint() {
+		uint64_t ret = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			unsigned char c = *read_bytes(1);
+			ret |= static_cast<uint64_t>(c & 0x7F) << shift;
+			if ((c & 0x80) == 0) {
+				return ret;
+			}
+		}
+		throw SagoTiledException("Binary map corrupt. Variable length integer too long at position %lu", (unsigned long)pos);
+	}
+
+	int64_t read_varint() {
+		uint64_t value = read_varuint();
+		return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+	}
+
+	int read_int() {
+		return static_cast<int>(read_varint());
+	}
+
+	double read_double() {
+		uint64_t bits = read_u32();
+		bits |= static_cast<uint64_t>(read_u32()) << 32;
+		double ret = 0.0;
+		memcpy(&ret, &bits, sizeof(ret));
+		return ret;
+	}
+
+	std::string read_string() {
+		size_t length = read_varuint();
+		const char* p = read_bytes(length);
+		return std::string(p, length);
+	}
+};
+
+/**
+ * Tells if the content looks like a map written by tilemap2binary
+ * @param content The content of a map file
+ * @return true if the content starts with the binary magic
+ */
+inline bool isBinaryTilemap(const std::string& content) {
+	return content.size() >= sizeof(binary_magic) && memcmp(content.data(), binary_magic, sizeof(binary_magic)) == 0;
+}
+
+inline void binary_write_properties(BinaryWriter& w, const std::map<std::string, TileProperty>& properties) {
+	w.write_varuint(properties.size());
+	for (const auto& prop : properties) {
+		w.write_string(prop.first);
+		w.write_string(prop.second.type);
+		w.write_string(prop.second.value);
+	}
+}
+
+inline void binary_read_properties(BinaryReader& r, std::map<std::string, TileProperty>& properties) {
+	size_t count = r.read_varuint();
+	for (size_t i = 0; i < count; ++i) {
+		TileProperty tp;
+		tp.name = r.read_string();
+		tp.type = r.read_string();
+		tp.value = r.read_string();
+		properties[tp.name] = tp;
+	}
+}
+
+inline void binary_write_tileset(BinaryWriter& w, const TileSet& ts) {
+	w.write_varint(ts.firstgid);
+	w.write_string(ts.source);
+	w.write_string(ts.name);
+	w.write_varint(ts.tilewidth);
+	w.write_varint(ts.tileheight);
+	w.write_varint(ts.spacing);
+	w.write_varint(ts.margin);
+	w.write_varint(ts.tilecount);
+	w.write_varint(ts.columns);
+	w.write_string(ts.image.source);
+	w.write_varint(ts.image.width);
+	w.write_varint(ts.image.height);
+	w.write_varuint(ts.terrainTypes.size());
+	for (const Terrain& t : ts.terrainTypes) {
+		w.write_string(t.name);
+		w.write_varint(t.tile);
+	}
+	w.write_varuint(ts.tiles.size());
+	for (const Tile& t : ts.tiles) {
+		w.write_varint(t.id);
+		w.write_string(t.terrain);
+		w.write_string(t.probability);
+		binary_write_properties(w, t.properties);
+	}
+}
+
+inline TileSet binary_read_tileset(BinaryReader& r, uint32_t version) {
+	TileSet ts;
+	ts.firstgid = r.read_int();
+	ts.source = r.read_string();
+	ts.name = r.read_string();
+	ts.tilewidth = r.read_int();
+	ts.tileheight = r.read_int();
+	ts.spacing = r.read_int();
+	ts.margin = r.read_int();
+	ts.tilecount = r.read_int();
+	ts.columns = r.read_int();
+	ts.image.source = r.read_string();
+	ts.image.width = r.read_int();
+	ts.image.height = r.read_int();
+	if (version < 5) {
+		return ts;
+	}
+	size_t terrain_count = r.read_varuint();
+	for (size_t i = 0; i < terrain_count; ++i) {
+		Terrain t;
+		t.name = r.read_string();
+		t.tile = r.read_int();
+		ts.terrainTypes.push_back(t);
+	}
+	size_t tile_count = r.read_varuint();
+	for (size_t i = 0; i < tile_count; ++i) {
+		Tile t;
+		t.id = r.read_int();
+		t.terrain = r.read_string();
+		t.probability = r.read_string();
+		binary_read_properties(r, t.properties);
+		ts.tiles_map[t.id] = t;
+		ts.tiles.push_back(t);
+	}
+	return ts;
+}
+
+inline void binary_write_objectgroup(BinaryWriter& w, const TileObjectGroup& tog) {
+	w.write_string(tog.name);
+	w.write_double(tog.opacity);
+	w.write_varuint(tog.objects.size());
+	for (const ObjectRecord& to : tog.objects) {
+		w.write_varint(to.id);
+		w.write_string(tog.str(to.name));
+		w.write_string(tog.str(to.type));
+		w.write_varint(to.x);
+		w.write_varint(to.y);
+		w.write_varint(to.width);
+		w.write_varint(to.height);
+		w.write_varuint((to.isEllipse ? 1 : 0) | (to.isPoint ? 2 : 0));
+		w.write_varuint(to.pointCount);
+		for (const auto& point : tog.points(to)) {
+			w.write_varint(point.first);
+			w.write_varint(point.second);
+		}
+		w.write_varuint(to.propertyCount);
+		for (const ObjectProperty& prop : tog.properties(to)) {
+			w.write_string(tog.str(prop.name));
+			w.write_string(tog.str(prop.type));
+			w.write_string(tog.str(prop.value));
+		}
+	}
+}
+
+inline TileObjectGroup binary_read_objectgroup(BinaryReader& r) {
+	TileObjectGroup tog;
+	tog.name = r.read_string();
+	tog.opacity = r.read_double();
+	size_t object_count = r.read_varuint();
+	tog.objects.reserve(object_count);
+	TileObject to;  //Reused, so the buffers are only allocated once
+	for (size_t i = 0; i < object_count; ++i) {
+		to.id = r.read_int();
+		to.name = r.read_string();
+		to.type = r.read_string();
+		to.x = r.read_int();
+		to.y = r.read_int();
+		to.width = r.read_int();
+		to.height = r.read_int();
+		uint64_t flags = r.read_varuint();
+		to.isEllipse = flags & 1;
+		to.isPoint = flags & 2;
+		size_t point_count = r.read_varuint();
+		to.polygon_points.clear();
+		for (size_t j = 0; j < point_count; ++j) {
+			int x = r.read_int();
+			int y = r.read_int();
+			to.polygon_points.push_back(std::make_pair(x, y));
+		}
+		to.properties.clear();
+		binary_read_properties(r, to.properties);
+		tog.add(to);
+	}
+	return tog;
+}
+
+/**
+ * Writes the chunks of a layer in an infinite map as the layer data.
+ * @return The chunk list or an empty string if there are no chunks
+ */
+inline std::string binary_layer_chunks(const std::vector<StoredChunk>& chunks) {
+	std::string ret;
+	if (chunks.empty()) {
+		return ret;
+	}
+	BinaryWriter w(ret);
+	w.write_varuint(chunks.size());
+	for (const StoredChunk& chunk : chunks) {
+		w.write_varint(chunk.x);
+		w.write_varint(chunk.y);
+		w.write_varint(chunk.width);
+		w.write_varint(chunk.height);
+		w.write_string(chunk.data->bytes);
+	}
+	return ret;
+}
+
+/**
+ * Reads the chunk list written by binary_layer_chunks into a layer that already has its final size.
+ * Whole chunks are kept compressed as pending chunks.
+ */
+inline void binary_read_layer_chunks(const char* data, size_t size, TileLayer& l, const std::string& compression, std::vector<uint32_t>& tiles) {
+	BinaryReader r(data, size);
+	size_t count = r.read_varuint();
+	for (size_t i = 0; i < count; ++i) {
+		int x = r.read_int();
+		int y = r.read_int();
+		int w = r.read_int();
+		int h = r.read_int();
+		size_t length = r.read_varuint();
+		add_layer_chunk(l, x, y, w, h, r.read_bytes(length), length, compression, tiles);
+	}
+}
+
+/**
+ * Serializes a TileMap to the binary format and writes it to a stream.
+ * Everything but the layer data is built in memory first, so the offsets are known. The layer data is then written directly
+ * from the tile grids or from the bytes stored at load time. Only changed layers are compressed and empty layers are skipped.
+ * The layers of infinite maps are written as lists of chunks. Chunks that were never loaded are written as they were read.
+ * External tilesets are only stored as a reference (like in TMX). The caller must inject them after loading. Embedded tilesets
+ * are stored with their terrains and tiles.
+ * @param out The stream to write to
+ * @param m The map to serialize
+ */
+inline void tilemap2binary(std::ostream& out, const TileMap& m) {
+	std::string ret;
+	BinaryWriter w(ret);
+	w.write_bytes(binary_magic, sizeof(binary_magic));
+	w.write_u32(binary_version);
+	w.write_string(m.version);
+	w.write_string(m.orientation);
+	w.write_string(m.renderorder);
+	w.write_varint(m.width);
+	w.write_varint(m.height);
+	w.write_varint(m.tilewidth);
+	w.write_varint(m.tileheight);
+	w.write_varint(m.nextobjectid);
+	w.write_varint(m.compressionlevel);
+	w.write_varuint(m.infinite ? 1 : 0);
+	w.write_varint(m.originx);
+	w.write_varint(m.originy);
+	binary_write_properties(w, m.properties);
+	w.write_varuint(m.tileset.size());
+	for (const TileSet& ts : m.tileset) {
+		binary_write_tileset(w, ts);
+	}
+	std::vector<size_t> offset_positions;
+	std::vector<LayerWriteScratch> scratch(m.layers.size());
+	std::vector<LayerBytes> stored(m.layers.size());
+	for_each_layer(m.layers.size(), [&](size_t i) {
+		if (m.infinite) {
+			scratch[i].compressed = binary_layer_chunks(collect_layer_chunks(m.layers[i].data, m.compressionlevel));
+			stored[i] = {scratch[i].compressed.data(), scratch[i].compressed.size()};
+			return;
+		}
+		if (m.layers[i].data.tiles.countNonZero() == 0) {
+			return;  //Stored with size 0
+		}
+		stored[i] = compressed_layer_data(m.layers[i].data, m.compressionlevel, scratch[i]);
+	});
+	w.write_u32(m.layers.size());
+	for (const TileLayer& l : m.layers) {
+		w.write_string(l.name);
+		w.write_varint(l.width);
+		w.write_varint(l.height);
+		w.write_string(l.data.encoding);
+		w.write_string(l.data.compression);
+		offset_positions.push_back(w.position());
+		w.write_u32(0);  //offset. Patched when the layer data is written
+		w.write_u32(0);  //size. Not known until compressed
+	}
+	w.write_varuint(m.object_groups.size());
+	for (const TileObjectGroup& tog : m.object_groups) {
+		binary_write_objectgroup(w, tog);
+	}
+	size_t offset = w.position();
+	for (size_t i = 0; i < m.layers.size(); ++i) {
+		w.patch_u32(offset_positions[i], offset);
+		w.patch_u32(offset_positions[i]+4, stored[i].size);
+		offset += stored[i].size;
+	}
+	out.write(ret.data(), ret.size());
+	for (size_t i = 0; i < m.layers.size(); ++i) {
+		out.write(stored[i].data, stored[i].size);
+	}
+}
+
+/**
+ * Serializes a TileMap to the binary format.
+ * @param m The map to serialize
+ * @return The binary representation of the map
+ */
+inline std::string tilemap2binary(const TileMap& m) {
+	std::ostringstream ret;
+	tilemap2binary(ret, m);
+	return ret.str();
+}
+
+/**
+ * Reads a map written by tilemap2binary.
+ * Throws SagoTiledException if the content is not a binary map, is of an unsupported version or is truncated.
+ * @param content The full content of the binary file
+ * @return The map
+ */
+inline TileMap binary2tilemap(const std::string& content) {
+	TileMap m;
+	if (!isBinaryTilemap(content)) {
+		throw SagoTiledException("Not a binary map");
+	}
+	BinaryReader r(content.data(), content.size());
+	r.read_bytes(sizeof(binary_magic));
+	uint32_t version = r.read_u32();
+	if (version < 1 || version > binary_version) {
+		throw SagoTiledException("Unsupported binary map version %u. Expected %u", version, binary_version);
+	}
+	m.version = r.read_string();
+	m.orientation = r.read_string();
+	m.renderorder = r.read_string();
+	m.width = r.read_int();
+	m.height = r.read_int();
+	m.tilewidth = r.read_int();
+	m.tileheight = r.read_int();
+	m.nextobjectid = r.read_int();
+	if (version >= 2) {
+		m.compressionlevel = r.read_int();
+	}
+	if (version >= 4) {
+		m.infinite = r.read_varuint();
+		m.originx = r.read_int();
+		m.originy = r.read_int();
+	}
+	binary_read_properties(r, m.properties);
+	size_t tileset_count = r.read_varuint();
+	for (size_t i = 0; i < tileset_count; ++i) {
+		m.tileset.push_back(binary_read_tileset(r, version));
+	}
+	uint32_t layer_count = r.read_u32();
+	m.layers.resize(layer_count);
+	std::vector<std::pair<const char*, uint32_t> > stored(layer_count);  //Decompressed on the layer workers once the table is read
+	std::vector<std::string> stored_compression(layer_count);  //Version 1 is always stored uncompressed
+	for (size_t i = 0; i < layer_count; ++i) {
+		TileLayer& l = m.layers[i];
+		l.name = r.read_string();
+		l.width = r.read_int();
+		l.height = r.read_int();
+		if (version >= 2) {
+			l.data.encoding = r.read_string();
+			l.data.compression = r.read_string();
+			stored_compression[i] = l.data.compression;
+		}
+		uint32_t offset = r.read_u32();
+		uint32_t size = r.read_u32();
+		if (l.width < 0 || l.height < 0) {
+			throw SagoTiledException("Layer %s has a negative size", l.name.c_str());
+		}
+		stored[i] = std::make_pair(r.bytes_at(offset, size), size);
+	}
+	for_each_layer(layer_count, [&](size_t i) {
+		TileLayer& l = m.layers[i];
+		const char* layer_data = stored[i].first;
+		const uint32_t size = stored[i].second;
+		l.data.tiles.resize(l.width, l.height);
+		if (size == 0) {
+			return;  //Empty layer
+		}
+		thread_local std::vector<uint32_t> tiles;
+		if (m.infinite) {
+			binary_read_layer_chunks(layer_data, size, l, stored_compression[i], tiles);
+			return;
+		}
+		tiles.resize(l.data.tiles.size());
+		getLayerCompression(stored_compression[i]).decompress(layer_data, size, reinterpret_cast<char*>(tiles.data()), tiles.size()*sizeof(uint32_t));
+		l.data.tiles.assign(tiles.data());
+		if (stored_compression[i].length()) {
+			l.data.setStoredBytes(layer_data, size);
+		}
+	});
+	size_t object_group_count = r.read_varuint();
+	for (size_t i = 0; i < object_group_count; ++i) {
+		m.object_groups.push_back(binary_read_objectgroup(r));
+	}
+	return m;
+}
+
+/**
+ * Size and speed of a layer codec when used for binary maps
+ */
+struct LayerCodecStats {
+	std::string codec;
+	size_t raw_size = 0;  //< Bytes of uncompressed layer data
+	size_t stored_size = 0;  //< Bytes of the entire binary map
+	double write_seconds = 0.0;  //< Average time for tilemap2binary
+	double read_seconds = 0.0;  //< Average time for binary2tilemap
+};
+
+/**
+ * Writes and reads the map with every available codec.
+ * Used to choose between save time and disk usage.
+ * @param m The map to measure. It is not changed
+ * @param level The compression level or -1 for the default of each codec
+ * @param runs Number of times to write and read for each codec. The time is the average
+ * @return One entry per codec in the order of getLayerCodecNames
+ */
+inline std::vector<LayerCodecStats> measureLayerCodecs(const TileMap& m, int level = -1, int runs = 5) {
+	std::vector<LayerCodecStats> ret;
+	TileMap copy = m;
+	loadAllPendingChunks(copy);  //Pending chunks would be written without compressing them
+	for (const std::string& codec : getLayerCodecNames()) {
+		setLayerCodec(copy, codec, level);
+		for (TileLayer& l : copy.layers) {
+			l.data.stored_bytes.clear();  //Measure the compression, not the reuse
+		}
+		LayerCodecStats stats;
+		stats.codec = codec;
+		for (const TileLayer& l : copy.layers) {
+			stats.raw_size += l.data.tiles.size()*sizeof(uint32_t);
+		}
+		std::string stored;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < runs; ++i) {
+			stored = tilemap2binary(copy);
+		}
+		auto written = std::chrono::steady_clock::now();
+		for (int i = 0; i < runs; ++i) {
+			binary2tilemap(stored);
+		}
+		auto read = std::chrono::steady_clock::now();
+		stats.stored_size = stored.size();
+		stats.write_seconds = std::chrono::duration<double>(written-start).count()/runs;
+		stats.read_seconds = std::chrono::duration<double>(read-written).count()/runs;
+		ret.push_back(stats);
+	}
+	return ret;
+}
+
+}  //tiled
+}  //sago
+
+#endif /* TMX_BINARY_H */
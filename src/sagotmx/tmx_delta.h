@@ -0,0 +1,329 @@
+/*
+Stores a map as the differences to a template map.
+Most of a generated map is an untouched copy of its template, so only the changed tiles and the changed object groups are kept.
+The delta is an ordinary TileMap and is saved with the binary format. The layers that are relative to the template hold the new
+gid of the changed tiles, delta_cleared for tiles that were cleared and 0 for unchanged tiles. Empty layers take almost no space.
+
+The template is identified by name and by tilemapContentHash. A delta is still applied if the template has changed since, but
+the tiles that were not changed then follow the new template. Callers that want to avoid that should check
+tilemapDeltaMatches before saving and store the full map instead.
+
+#License
+Provided under the MIT license. The license is as follows:
+Copyright (c) 2017 Poul Sander
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef TMX_DELTA_H
+#define TMX_DELTA_H
+
+#include "tmx_binary.h"
+#include <cstdio>
+
+namespace sago {
+namespace tiled {
+
+/**
+ * The value in a delta layer for a tile that is 0 in the map but not in the template
+ */
+const uint32_t delta_cleared = UINT32_MAX;
+
+const char delta_template_property[] = "delta_template";
+const char delta_hash_property[] = "delta_template_hash";
+const char delta_layers_property[] = "delta_layers";  //< Names of the layers that are relative to the template. One per line
+const char delta_object_groups_property[] = "delta_object_groups";  //< Names of the object groups that are copied from the template
+
+inline void setMapProperty(TileMap& m, const std::string& name, const std::string& value) {
+	TileProperty& tp = m.properties[name];
+	tp.name = name;
+	tp.value = value;
+}
+
+inline std::string getMapProperty(const TileMap& m, const std::string& name) {
+	const auto itr = m.properties.find(name);
+	if (itr == m.properties.end()) {
+		return "";
+	}
+	return itr->second.value;
+}
+
+/**
+ * Checksum of the layers and object groups of a map. Stable between runs and platforms.
+ * @return The checksum as 8 hex digits
+ */
+inline std::string tilemapContentHash(const TileMap& m) {
+	uLong crc = crc32(0L, Z_NULL, 0);
+	std::string buffer;
+	BinaryWriter w(buffer);
+	std::vector<uint32_t> tiles;
+	for (const TileLayer& l : m.layers) {
+		buffer.clear();
+		w.write_string(l.name);
+		w.write_varint(l.data.tiles.width());
+		w.write_varint(l.data.tiles.height());
+		crc = crc32(crc, reinterpret_cast<const Bytef*>(buffer.data()), buffer.size());
+		tiles.resize(l.data.tiles.size());
+		l.data.tiles.copyTo(tiles.data());
+		crc = crc32(crc, reinterpret_cast<const Bytef*>(tiles.data()), tiles.size()*sizeof(uint32_t));
+	}
+	for (const TileObjectGroup& group : m.object_groups) {
+		buffer.clear();
+		binary_write_objectgroup(w, group);
+		crc = crc32(crc, reinterpret_cast<const Bytef*>(buffer.data()), buffer.size());
+	}
+	char ret[16];
+	snprintf(ret, sizeof(ret), "%08lx", (unsigned long)(crc & 0xFFFFFFFF));
+	return ret;
+}
+
+/**
+ * Returns the tiles of tiles that differ from base. See the top of the file for the values.
+ * Equal chunks are skipped after a single compare.
+ */
+inline TileGrid tileGridDelta(const TileGrid& base, const TileGrid& tiles) {
+	TileGrid ret(tiles.width(), tiles.height());
+	const int size = TileChunk::size;
+	uint32_t base_chunk[size*size];
+	uint32_t chunk[size*size];
+	for (int y = 0; y < tiles.height(); y += size) {
+		for (int x = 0; x < tiles.width(); x += size) {
+			const int w = std::min(size, tiles.width()-x);
+			const int h = std::min(size, tiles.height()-y);
+			const size_t count = (size_t)w*h;
+			base.copyRectTo(x, y, w, h, base_chunk);
+			tiles.copyRectTo(x, y, w, h, chunk);
+			if (std::equal(chunk, chunk+count, base_chunk)) {
+				continue;
+			}
+			for (size_t i = 0; i < count; ++i) {
+				if (chunk[i] == base_chunk[i]) {
+					chunk[i] = 0;
+				}
+				else if (chunk[i] == 0) {
+					chunk[i] = delta_cleared;
+				}
+			}
+			ret.assignRect(x, y, w, h, chunk);
+		}
+	}
+	return ret;
+}
+
+/**
+ * Applies the result of tileGridDelta. tiles must hold the template and have the size of the delta.
+ * Only the chunks of the delta that have changes are visited.
+ */
+inline void applyTileGridDelta(TileGrid& tiles, const TileGrid& delta) {
+	const int size = TileChunk::size;
+	uint32_t delta_chunk[size*size];
+	uint32_t chunk[size*size];
+	for (int y = 0; y < delta.height(); y += size) {
+		for (int x = 0; x < delta.width(); x += size) {
+			const int w = std::min(size, delta.width()-x);
+			const int h = std::min(size, delta.height()-y);
+			if (delta.countNonZero(x, y, w, h) == 0) {
+				continue;
+			}
+			delta.copyRectTo(x, y, w, h, delta_chunk);
+			tiles.copyRectTo(x, y, w, h, chunk);
+			for (size_t i = 0; i < (size_t)w*h; ++i) {
+				if (delta_chunk[i] == delta_cleared) {
+					chunk[i] = 0;
+				}
+				else if (delta_chunk[i]) {
+					chunk[i] = delta_chunk[i];
+				}
+			}
+			tiles.assignRect(x, y, w, h, chunk);
+		}
+	}
+}
+
+inline std::vector<std::string> splitLines(const std::string& value) {
+	std::vector<std::string> ret;
+	std::istringstream stream(value);
+	std::string line;
+	while (std::getline(stream, line)) {
+		ret.push_back(line);
+	}
+	return ret;
+}
+
+inline const TileLayer* findLayer(const TileMap& m, const std::string& name) {
+	for (const TileLayer& l : m.layers) {
+		if (l.name == name) {
+			return &l;
+		}
+	}
+	return nullptr;
+}
+
+inline const TileObjectGroup* findObjectGroup(const TileMap& m, const std::string& name) {
+	for (const TileObjectGroup& group : m.object_groups) {
+		if (group.name == name) {
+			return &group;
+		}
+	}
+	return nullptr;
+}
+
+inline bool isTilemapDelta(const TileMap& m) {
+	return m.properties.find(delta_template_property) != m.properties.end();
+}
+
+/**
+ * @return The name of the template that the delta was made against
+ */
+inline std::string tilemapDeltaTemplate(const TileMap& delta) {
+	return getMapProperty(delta, delta_template_property);
+}
+
+/**
+ * Tells if the delta was made against the template with this tilemapContentHash
+ */
+inline bool tilemapDeltaMatches(const std::string& base_hash, const TileMap& delta) {
+	return getMapProperty(delta, delta_hash_property) == base_hash;
+}
+
+/**
+ * Tells if the delta was made against this exact template
+ */
+inline bool tilemapDeltaMatches(const TileMap& base, const TileMap& delta) {
+	return tilemapDeltaMatches(tilemapContentHash(base), delta);
+}
+
+/**
+ * Makes a map that only holds what differs from base.
+ * Layers are matched by name. Layers that base does not have are stored in full. Object groups that are equal to the group
+ * with the same name in base are stored empty.
+ * @param base The template
+ * @param m The map to store
+ * @param base_name The name the template can be found by when the delta is applied
+ * @param base_hash tilemapContentHash of base if the caller has it. Hashing reads the entire template, so callers that save
+ * often should compute it once. Computed if empty
+ * @return The delta
+ */
+inline TileMap makeTilemapDelta(const TileMap& base, const TileMap& m, const std::string& base_name, const std::string& base_hash = "") {
+	TileMap ret = m;  //Only shares the chunks
+	loadAllPendingChunks(ret);
+	TileMap loaded_base;
+	const TileMap* template_map = &base;
+	if (hasPendingChunks(base)) {
+		loaded_base = base;
+		loadAllPendingChunks(loaded_base);
+		template_map = &loaded_base;
+	}
+	std::string delta_layers;
+	for (TileLayer& l : ret.layers) {
+		const TileLayer* base_layer = findLayer(*template_map, l.name);
+		if (!base_layer) {
+			continue;
+		}
+		l.data.tiles = tileGridDelta(base_layer->data.tiles, l.data.tiles);
+		delta_layers += l.name + "\n";
+	}
+	std::string delta_groups;
+	std::string group_bytes;
+	std::string base_group_bytes;
+	for (TileObjectGroup& group : ret.object_groups) {
+		const TileObjectGroup* base_group = findObjectGroup(*template_map, group.name);
+		if (!base_group) {
+			continue;
+		}
+		group_bytes.clear();
+		base_group_bytes.clear();
+		BinaryWriter group_writer(group_bytes);
+		BinaryWriter base_writer(base_group_bytes);
+		binary_write_objectgroup(group_writer, group);
+		binary_write_objectgroup(base_writer, *base_group);
+		if (group_bytes == base_group_bytes) {
+			group.clear();
+			delta_groups += group.name + "\n";
+		}
+	}
+	setMapProperty(ret, delta_template_property, base_name);
+	setMapProperty(ret, delta_hash_property, base_hash.empty() ? tilemapContentHash(*template_map) : base_hash);
+	setMapProperty(ret, delta_layers_property, delta_layers);
+	setMapProperty(ret, delta_object_groups_property, delta_groups);
+	return ret;
+}
+
+/**
+ * Rebuilds the map from a delta made by makeTilemapDelta.
+ * Layers that are unchanged share their chunks with base. If a layer of the template has changed size, the part that
+ * overlaps the delta is used.
+ * @param base The template
+ * @param delta The delta
+ * @return The map
+ */
+inline TileMap applyTilemapDelta(const TileMap& base, const TileMap& delta) {
+	TileMap ret = delta;
+	const std::vector<std::string> delta_layers = splitLines(getMapProperty(ret, delta_layers_property));
+	const std::vector<std::string> delta_groups = splitLines(getMapProperty(ret, delta_object_groups_property));
+	ret.properties.erase(delta_template_property);
+	ret.properties.erase(delta_hash_property);
+	ret.properties.erase(delta_layers_property);
+	ret.properties.erase(delta_object_groups_property);
+	loadAllPendingChunks(ret);
+	for (TileLayer& l : ret.layers) {
+		if (std::find(delta_layers.begin(), delta_layers.end(), l.name) == delta_layers.end()) {
+			continue;
+		}
+		const TileLayer* base_layer = findLayer(base, l.name);
+		if (base_layer && base_layer->data.pending_chunks.empty() && l.data.tiles.countNonZero() == 0
+				&& base_layer->data.tiles.width() == l.data.tiles.width() && base_layer->data.tiles.height() == l.data.tiles.height()) {
+			//Unchanged. Also keeps the stored bytes of the template so the layer is not compressed again on save
+			const std::string compression = l.data.compression;
+			l.data = base_layer->data;
+			l.data.compression = compression;
+			continue;
+		}
+		TileGrid tiles;
+		if (base_layer && base_layer->data.pending_chunks.size()) {
+			TileLayer loaded = *base_layer;
+			loadPendingChunks(loaded, 0, 0, loaded.data.tiles.width(), loaded.data.tiles.height());
+			tiles = loaded.data.tiles;
+		}
+		else if (base_layer) {
+			tiles = base_layer->data.tiles;
+		}
+		if (tiles.width() != l.data.tiles.width() || tiles.height() != l.data.tiles.height()) {
+			TileGrid resized(l.data.tiles.width(), l.data.tiles.height());
+			resized.copyRect(tiles, 0, 0, tiles.width(), tiles.height(), 0, 0);
+			tiles = resized;
+		}
+		applyTileGridDelta(tiles, l.data.tiles);
+		l.data.tiles = tiles;
+	}
+	for (TileObjectGroup& group : ret.object_groups) {
+		if (std::find(delta_groups.begin(), delta_groups.end(), group.name) == delta_groups.end()) {
+			continue;
+		}
+		const TileObjectGroup* base_group = findObjectGroup(base, group.name);
+		if (base_group) {
+			group = *base_group;
+		}
+	}
+	return ret;
+}
+
+}  //tiled
+}  //sago
+
+#endif /* TMX_DELTA_H */
@@ -0,0 +1,214 @@
+/*
+Journal of the changes to a map since it was last saved in full.
+Saving a single changed tile should not require the entire map to be written again. Instead the changes are appended to a
+journal that is replayed on top of the saved map when it is loaded.
+
+The journal is a sequence of blocks. Each append is one block:
+u32 payload length, u32 crc32 of the payload, payload
+The payload starts with the id of the saved map the changes apply to, followed by entries:
+1 (varuint), layer, x, y, old tile, new tile (varuints): A tile was changed
+2 (varuint), object group (as in the binary map): An object group was changed or added. Replaces the group with the same name
+A block that is cut short or has a wrong checksum ends the journal, so a crash while appending only loses that block.
+Blocks for another id are skipped. Give the saved map a new id every time it is saved in full and old journals are ignored
+even if removing them failed.
+
+#License
+Provided under the MIT license. The license is as follows:
+Copyright (c) 2017 Poul Sander
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+ */
+
+#ifndef TMX_JOURNAL_H
+#define TMX_JOURNAL_H
+
+#include "tmx_binary.h"
+
+namespace sago {
+namespace tiled {
+
+enum class JournalEntry : uint8_t {
+	tile = 1,
+	object_group = 2,
+};
+
+/**
+ * Remembers a state of a map and writes the changes made after it as journal blocks.
+ */
+class TileMapJournal {
+public:
+	/**
+	 * Makes the current state of m the one that changes are measured against.
+	 * Cheap. The tiles are shared with m until m is changed.
+	 */
+	void track(const TileMap& m) {
+		layers_.clear();
+		for (const TileLayer& l : m.layers) {
+			layers_.push_back({l.data.tiles, l.data.pending_chunks});
+		}
+		object_groups_.clear();
+		for (const TileObjectGroup& group : m.object_groups) {
+			object_groups_[group.name] = groupBytes(group);
+		}
+	}
+
+	/**
+	 * Returns a journal block with the changes to m since the last call to track or takeChanges and then tracks m.
+	 * Takes time in proportion to the number of changed tile chunks, not the size of the map.
+	 * @param m The map
+	 * @param base_id The id of the saved map
+	 * @return The block or an empty string if nothing has changed
+	 */
+	std::string takeChanges(const TileMap& m, const std::string& base_id) {
+		std::string payload;
+		BinaryWriter w(payload);
+		w.write_string(base_id);
+		const size_t header_size = payload.size();
+		for (size_t i = 0; i < m.layers.size(); ++i) {
+			const TileLayerData& data = m.layers[i].data;
+			TileGrid older(data.tiles.width(), data.tiles.height());
+			if (i < layers_.size() && layers_[i].tiles.width() == data.tiles.width() && layers_[i].tiles.height() == data.tiles.height()) {
+				older = olderTiles(layers_[i], data);
+			}
+			data.tiles.forEachChange(older, [&w, i](int x, int y, uint32_t old_tile, uint32_t new_tile) {
+				w.write_varuint(static_cast<uint64_t>(JournalEntry::tile));
+				w.write_varuint(i);
+				w.write_varuint(x);
+				w.write_varuint(y);
+				w.write_varuint(old_tile);
+				w.write_varuint(new_tile);
+			});
+		}
+		for (const TileObjectGroup& group : m.object_groups) {
+			const std::string bytes = groupBytes(group);
+			const auto itr = object_groups_.find(group.name);
+			if (itr != object_groups_.end() && itr->second == bytes) {
+				continue;
+			}
+			w.write_varuint(static_cast<uint64_t>(JournalEntry::object_group));
+			w.write_bytes(bytes.data(), bytes.size());
+		}
+		track(m);
+		if (payload.size() == header_size) {
+			return "";
+		}
+		std::string ret;
+		BinaryWriter block(ret);
+		block.write_u32(payload.size());
+		block.write_u32(crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(payload.data()), payload.size()));
+		block.write_bytes(payload.data(), payload.size());
+		return ret;
+	}
+
+private:
+	struct TrackedLayer {
+		TileGrid tiles;
+		std::map<std::pair<int, int>, std::shared_ptr<const PendingChunk> > pending_chunks;
+	};
+
+	static std::string groupBytes(const TileObjectGroup& group) {
+		std::string ret;
+		BinaryWriter w(ret);
+		binary_write_objectgroup(w, group);
+		return ret;
+	}
+
+	/**
+	 * The tracked tiles of a layer. Chunks that were pending then but have been loaded since are decoded, so loading a chunk
+	 * does not count as a change.
+	 */
+	static TileGrid olderTiles(const TrackedLayer& older, const TileLayerData& current) {
+		TileGrid ret = older.tiles;
+		const int size = TileChunk::size;
+		uint32_t tiles[size*size];
+		for (const auto& [key, chunk] : older.pending_chunks) {
+			if (current.pending_chunks.count(key)) {
+				continue;
+			}
+			decode_pending_chunk(*chunk, tiles);
+			ret.assignRect(key.first*size, key.second*size, size, size, tiles);
+		}
+		return ret;
+	}
+
+	std::vector<TrackedLayer> layers_;
+	std::map<std::string, std::string> object_groups_;  //< binary_write_objectgroup of each group by name
+};
+
+/**
+ * Applies the blocks of a journal that belong to base_id.
+ * Stops at the first block that is incomplete or damaged.
+ * @param m The map as it was saved
+ * @param journal The content of the journal
+ * @param base_id The id of the saved map
+ * @return The number of blocks applied
+ */
+inline size_t applyTilemapJournal(TileMap& m, const std::string& journal, const std::string& base_id) {
+	size_t ret = 0;
+	BinaryReader blocks(journal.data(), journal.size());
+	while (blocks.position() + 8 <= journal.size()) {
+		const uint32_t length = blocks.read_u32();
+		const uint32_t crc = blocks.read_u32();
+		if (length > journal.size()-blocks.position()) {
+			break;
+		}
+		const char* payload = blocks.read_bytes(length);
+		if (crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(payload), length) != crc) {
+			break;
+		}
+		BinaryReader r(payload, length);
+		if (r.read_string() != base_id) {
+			continue;
+		}
+		while (r.position() < length) {
+			const JournalEntry entry = static_cast<JournalEntry>(r.read_varuint());
+			if (entry == JournalEntry::tile) {
+				const size_t layer = r.read_varuint();
+				const int x = r.read_varuint();
+				const int y = r.read_varuint();
+				r.read_varuint();  //The old tile is only there for tools
+				const uint32_t tile = r.read_varuint();
+				if (layer < m.layers.size() && m.layers[layer].data.tiles.inBounds(x, y)) {
+					setTileOnLayerNumber(m, layer, x, y, tile);
+				}
+			}
+			else if (entry == JournalEntry::object_group) {
+				TileObjectGroup group = binary_read_objectgroup(r);
+				auto itr = std::find_if(m.object_groups.begin(), m.object_groups.end(), [&group](const TileObjectGroup& g) {
+					return g.name == group.name;
+				});
+				if (itr != m.object_groups.end()) {
+					*itr = std::move(group);
+				}
+				else {
+					m.object_groups.push_back(std::move(group));
+				}
+			}
+			else {
+				throw SagoTiledException("Map journal corrupt. Unknown entry %d", static_cast<int>(entry));
+			}
+		}
+		++ret;
+	}
+	return ret;
+}
+
+}  //tiled
+}  //sago
+
+#endif /* TMX_JOURNAL_H */
@@ -5,6 +5,8 @@ It is designed especially for reading the default map format produced by Tiled 0
 Another feature is that files can be loaded from memory. Mostly to use it with PhysFS
 This does put a bit of extra pressure on the user because if the TileSet in ints own file the user must provide it.
 
+Infinite maps are read and written as chunks. The chunks stay compressed until loadPendingChunks is called for them.
+
 It still has some limitations:
 * Cannot auto load the tileset (cannot access the filesystem)
 * Only one (1) TileSet
@@ -15,7 +17,6 @@ Compiles with g++ and requires C++11 support.
 Requirements:
 * zlib (http://www.zlib.net/)
 * rapidxml (http://rapidxml.sourceforge.net/)
-* b64 (http://libb64.sourceforge.net/), Although for modern compilers several patches are needed. I have used the ones from Debian
 
 #License
 Provided under the MIT license. The license is as follows:
@@ -48,12 +49,22 @@ SOFTWARE.
 #include <sstream>
 #include <cstring>
 #include <cstdint>
+#include <climits>
 #include <vector>
 #include <map>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
 #include <zlib.h>
+#ifdef SAGOTMX_WITH_ZSTD
+#include <zstd.h>
+#endif
 #include <iostream>
-#include "b64/decode.h"
-#include "b64/encode.h"
+#include "tmx_base64.h"
+#include "tile_grid.h"
+#include "layer_workers.h"
 
 namespace sago {
 namespace tiled {
@@ -124,33 +135,34 @@ inline std::string zlib_decompress(const char *source, unsigned int slength) {
 	return res;
 }
 
-inline std::string zlib_compress(const std::string& source) {
+/**
+ * Deflates a buffer.
+ * @param source data to compress
+ * @param length length of the data
+ * @param level zlib compression level (0-9)
+ * @param window_bits 15 for a zlib stream and 15 | 16 for a gzip stream
+ * @return the compressed data
+ */
+inline std::string zlib_compress(const char* source, size_t length, int level, int window_bits) {
 	std::string res;
-	char buffer[1024];
 	z_stream strm;
 	
 	strm.zalloc = z_alloc;
 	strm.zfree = z_free;
 	strm.opaque = Z_NULL;
-	strm.next_in = (Bytef*)source.data();
-	strm.avail_in = source.size();
-	strm.next_out = (Bytef*)buffer;
-	strm.avail_out = sizeof(buffer);
-	
-	int ret = deflateInit2(&strm, Z_BEST_SPEED,Z_DEFLATED, 15 | 16,
+	int ret = deflateInit2(&strm, level, Z_DEFLATED, window_bits,
               8,
               Z_DEFAULT_STRATEGY);
 	if (ret != Z_OK) {
 		throw SagoTiledException("zlib error: deflateInit2 returned %d", ret);
 	}
-	while (ret == Z_OK) {
-		ret = deflate(&strm, Z_FINISH);
-		if (ret == Z_OK || ret == Z_STREAM_END) {
-			res.append(buffer, sizeof(buffer));
-			strm.next_out = (Bytef*)buffer;
-			strm.avail_out = sizeof(buffer);
-		}
-	}
+	// deflateBound is large enough to finish in a single call
+	res.resize(deflateBound(&strm, length));
+	strm.next_in = (Bytef*)source;
+	strm.avail_in = length;
+	strm.next_out = (Bytef*)&res[0];
+	strm.avail_out = res.size();
+	ret = deflate(&strm, Z_FINISH);
 	if ( ret != Z_STREAM_END) {
 		deflateEnd(&strm);
 		throw SagoTiledException("zlib error: deflate returned %d", ret);
@@ -161,8 +173,6 @@ inline std::string zlib_compress(const std::string& source) {
 	return res;
 }
 
-const char* const b64enc = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-
 /**
  * This functions will skip whitespace until it finds a base64 encoding charecter. It will then decode it and decompress it.
  * @param data base64 encoded data of a zlib compressed array of gids_count uint32 elements.
@@ -171,24 +181,201 @@ const char* const b64enc = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz
  */
 inline std::string string_decompress_decode(const std::string &data)
 {
-	std::size_t found = data.find_first_of(b64enc);
-	if (found == std::string::npos) {
+	std::string compressed_str;
+	compressed_str.resize(base64_decoded_max_length(data.length()));
+	compressed_str.resize(base64_decode(data.data(), data.length(), &compressed_str[0]));
+	if (compressed_str.empty()) {
 		std::cerr << "Warning: Layer without data... this is most likely a mistake.\n";
 		return "";
 	}
-	std::string compressed_str;
-	compressed_str.resize(data.length());
-	base64::decoder decoder;
-	decoder.decode(&data[found], data.length()-found, &compressed_str[0]);
 	return zlib_decompress(compressed_str.c_str(), compressed_str.length());
 }
 
+/**
+ * Scratch memory reused between the layers of a single parse.
+ * The base64 decoded (but still compressed) bytes and the decompressed tiles are placed here, so the only per layer
+ * allocations are the chunks of the tile grid.
+ */
+struct TmxParseScratch {
+	std::vector<char> decoded;
+	std::vector<uint32_t> tiles;
+};
+
+/**
+ * Inflates a zlib or gzip stream into a buffer that already has the final size.
+ * @param source compressed data
+ * @param slength length of the compressed data
+ * @param dest destination buffer. Must be exactly dlength bytes.
+ * @param dlength expected size of the uncompressed data
+ */
+inline void zlib_decompress_into(const char *source, size_t slength, char* dest, size_t dlength) {
+	z_stream strm;
+	strm.zalloc = z_alloc;
+	strm.zfree = z_free;
+	strm.opaque = Z_NULL;
+	strm.next_in = (Bytef*)source;
+	strm.avail_in = slength;
+	strm.next_out = (Bytef*)dest;
+	strm.avail_out = dlength;
+	int ret = inflateInit2(&strm, 15 + 32);
+	if (ret != Z_OK) {
+		throw SagoTiledException("zlib error: inflateInit2 returned %d", ret);
+	}
+	ret = inflate(&strm, Z_FINISH);
+	size_t total_out = strm.total_out;
+	inflateEnd(&strm);
+	if (ret == Z_BUF_ERROR && strm.avail_out == 0) {
+		throw SagoTiledException("zlib error: data larger than the expected %lu bytes", (unsigned long)dlength);
+	}
+	if (ret != Z_STREAM_END) {
+		throw SagoTiledException("zlib error: inflate returned %d", ret);
+	}
+	if (total_out != dlength) {
+		throw SagoTiledException("zlib error: got %lu bytes, expected %lu", (unsigned long)total_out, (unsigned long)dlength);
+	}
+}
+
+#ifdef SAGOTMX_WITH_ZSTD
+inline std::string zstd_compress(const char* source, size_t length, int level) {
+	std::string res;
+	res.resize(ZSTD_compressBound(length));
+	size_t ret = ZSTD_compress(&res[0], res.size(), source, length, level);
+	if (ZSTD_isError(ret)) {
+		throw SagoTiledException("zstd error: %s", ZSTD_getErrorName(ret));
+	}
+	res.resize(ret);
+	return res;
+}
+
+inline void zstd_decompress_into(const char *source, size_t slength, char* dest, size_t dlength) {
+	size_t ret = ZSTD_decompress(dest, dlength, source, slength);
+	if (ZSTD_isError(ret)) {
+		throw SagoTiledException("zstd error: %s", ZSTD_getErrorName(ret));
+	}
+	if (ret != dlength) {
+		throw SagoTiledException("zstd error: got %lu bytes, expected %lu", (unsigned long)ret, (unsigned long)dlength);
+	}
+}
+#endif
+
+/**
+ * A compression that can be used for tile layer data.
+ * The name is the value of the "compression" attribute in TMX. The empty name means no compression.
+ * zlib and gzip use Z_BEST_SPEED unless a level is given, because maps are saved often and are mostly zeros.
+ */
+struct LayerCompression {
+	/**
+	 * Compresses length bytes. level is -1 for the default level of the compression
+	 */
+	std::string (*compress)(const char* source, size_t length, int level) = nullptr;
+	/**
+	 * Decompresses into dest. Must throw SagoTiledException if the result is not exactly dlength bytes
+	 */
+	void (*decompress)(const char* source, size_t slength, char* dest, size_t dlength) = nullptr;
+};
+
+inline std::map<std::string, LayerCompression>& layerCompressions() {
+	//Initialized once in a thread safe way. The layer workers look compressions up concurrently
+	static std::map<std::string, LayerCompression> compressions = []() {
+		std::map<std::string, LayerCompression> compressions;
+		LayerCompression none;
+		none.compress = [](const char* source, size_t length, int) {
+			return std::string(source, length);
+		};
+		none.decompress = [](const char* source, size_t slength, char* dest, size_t dlength) {
+			if (slength != dlength) {
+				throw SagoTiledException("Uncompressed layer has %lu bytes, expected %lu", (unsigned long)slength, (unsigned long)dlength);
+			}
+			memcpy(dest, source, slength);
+		};
+		compressions[""] = none;
+		LayerCompression zlib;
+		zlib.compress = [](const char* source, size_t length, int level) {
+			return zlib_compress(source, length, level < 0 ? Z_BEST_SPEED : level, 15);
+		};
+		zlib.decompress = zlib_decompress_into;
+		compressions["zlib"] = zlib;
+		LayerCompression gzip;
+		gzip.compress = [](const char* source, size_t length, int level) {
+			return zlib_compress(source, length, level < 0 ? Z_BEST_SPEED : level, 15 | 16);
+		};
+		gzip.decompress = zlib_decompress_into;  // Detects the header itself
+		compressions["gzip"] = gzip;
+#ifdef SAGOTMX_WITH_ZSTD
+		LayerCompression zstd;
+		zstd.compress = [](const char* source, size_t length, int level) {
+			return zstd_compress(source, length, level < 0 ? ZSTD_CLEVEL_DEFAULT : level);
+		};
+		zstd.decompress = zstd_decompress_into;
+		compressions["zstd"] = zstd;
+#endif
+		return compressions;
+	}();
+	return compressions;
+}
+
+/**
+ * Adds or replaces a layer compression. Can be used to add compressions that this library does not know about.
+ * Not thread safe. Must only be called during initialization, before any map is read or written, because the layer
+ * workers look compressions up concurrently without locking.
+ */
+inline void registerLayerCompression(const std::string& name, const LayerCompression& compression) {
+	layerCompressions()[name] = compression;
+}
+
+/**
+ * @return true if the compression can be used in this build. "" (uncompressed) is always available
+ */
+inline bool hasLayerCompression(const std::string& name) {
+	return layerCompressions().count(name) > 0;
+}
+
+/**
+ * Returns the compression with the given name.
+ * Throws SagoTiledException if the compression is unknown (for instance zstd in a build without SAGOTMX_WITH_ZSTD)
+ */
+inline const LayerCompression& getLayerCompression(const std::string& name) {
+	const auto& compressions = layerCompressions();
+	const auto itr = compressions.find(name);
+	if (itr == compressions.end()) {
+		throw SagoTiledException("The layer compression \"%s\" is not available in this build%s", name.c_str(),
+			name == "zstd" ? " (built without SAGOTMX_WITH_ZSTD)" : "");
+	}
+	return itr->second;
+}
+
+/**
+ * The names of the codecs that can be passed to setLayerCodec.
+ * "csv" and "base64" are stored uncompressed. The rest are the registered compressions.
+ */
+inline std::vector<std::string> getLayerCodecNames() {
+	std::vector<std::string> ret = {"csv", "base64"};
+	for (const auto& compression : layerCompressions()) {
+		if (compression.first.length()) {
+			ret.push_back(compression.first);
+		}
+	}
+	return ret;
+}
+
+/**
+ * Base64 encodes directly to a stream. Gives the same output as string_encode without the intermediate strings.
+ */
+inline void stream_encode(std::ostream& out, const char* data, size_t length) {
+	const size_t block_size = 3*4096;  //Whole groups, so only the last block is padded
+	char code[4*4096];
+	while (length > 0) {
+		size_t block = std::min(length, block_size);
+		out.write(code, base64_encode(data, block, code));
+		data += block;
+		length -= block;
+	}
+}
+
 inline std::string string_encode( const std::string& data) {
-	std::stringstream ret;
-	std::stringstream input(data);
-	base64::encoder E;
-	E.encode(input, ret);
-	return ret.str();
+	std::string ret(base64_encoded_length(data.length()), '\0');
+	base64_encode(data.data(), data.length(), &ret[0]);
+	return ret;
 }
 
 struct Terrain {
@@ -200,10 +387,17 @@ struct TerrainTypes {
 	std::vector<Terrain> terrains;
 };
 
+struct TileProperty {
+	std::string name;
+	std::string type;
+	std::string value;
+};
+
 struct Tile {
 	int id = 0;
 	std::string terrain;
 	std::string probability;
+	std::map<std::string, TileProperty> properties;
 };
 
 struct Image {
@@ -216,7 +410,7 @@ struct Image {
 struct TileSet {
 	int firstgid = 0;
 	std::string source;
-	TileSet* alternativeSource = nullptr;  //< Set to non-null to use an alternative TileSet. Must be set if source is set.
+	const TileSet* alternativeSource = nullptr;  //< Set to non-null to use an alternative TileSet. Must be set if source is set.
 	std::string name;
 	int tilewidth = 0;
 	int tileheight = 0;
@@ -230,10 +424,43 @@ struct TileSet {
 	std::map<int, Tile> tiles_map;
 };
 
+/**
+ * A chunk of an infinite map that has been read but not decoded yet.
+ * bytes holds TileChunk::size x TileChunk::size tiles compressed with compression, exactly as they were stored in the file.
+ */
+struct PendingChunk {
+	std::string compression;
+	std::string bytes;
+};
+
 struct TileLayerData {
 	std::string encoding = "base64";
 	std::string compression = "zlib";
-	std::string payload;
+	TileGrid tiles;
+	/**
+	 * Chunks of an infinite map that are not decoded yet, by chunk column and row in tiles.
+	 * The tiles of a pending chunk read as 0 until loadPendingChunks is called for them.
+	 * The chunks are immutable, so copies of the layer share them.
+	 */
+	std::map<std::pair<int, int>, std::shared_ptr<const PendingChunk> > pending_chunks;
+	/**
+	 * The tiles exactly as they were compressed in the file they were loaded from, and the compression used.
+	 * The writers reuse them instead of compressing again as long as the compression is the same and
+	 * the revision of the tiles has not changed since.
+	 */
+	std::string stored_bytes;
+	std::string stored_compression;
+	uint64_t stored_revision = 0;
+
+	bool hasStoredBytes() const {
+		return stored_bytes.length() && stored_revision == tiles.revision() && stored_compression == compression;
+	}
+
+	void setStoredBytes(const char* data, size_t length) {
+		stored_bytes.assign(data, length);
+		stored_compression = compression;
+		stored_revision = tiles.revision();
+	}
 };
 
 struct TileLayer {
@@ -243,12 +470,36 @@ struct TileLayer {
 	TileLayerData data;
 };
 
-struct TileProperty {
-	std::string name;
-	std::string type;
-	std::string value;
+/**
+ * The object types the engine looks for. Found once when an object is added to a group, so scans compare a byte instead of a string.
+ */
+enum class ObjectType : uint8_t {
+	other,
+	blocking,
+	itemSpawn,
+	text,
+	playerStart,
 };
 
+inline ObjectType objectTypeFromName(const std::string& type) {
+	if (type == "blocking") {
+		return ObjectType::blocking;
+	}
+	if (type == "itemSpawn") {
+		return ObjectType::itemSpawn;
+	}
+	if (type == "text") {
+		return ObjectType::text;
+	}
+	if (type == "playerStart") {
+		return ObjectType::playerStart;
+	}
+	return ObjectType::other;
+}
+
+/**
+ * An object that owns its strings. Used to build objects before they are added to a TileObjectGroup.
+ */
 struct TileObject {
 	int id = 0;
 	std::string name;
@@ -263,10 +514,176 @@ struct TileObject {
 	std::map<std::string, TileProperty> properties;
 };
 
-struct TileObjectGroup {
+/**
+ * A property of an object. The strings are ids in the string pool of the group.
+ */
+struct ObjectProperty {
+	uint32_t name = 0;
+	uint32_t type = 0;
+	uint32_t value = 0;
+};
+
+/**
+ * An object as stored in a TileObjectGroup. The strings, properties and polygon points are in the pools of the group.
+ */
+struct ObjectRecord {
+	int id = 0;
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+	uint32_t name = 0;  //< String id
+	uint32_t type = 0;  //< String id
+	ObjectType kind = ObjectType::other;
+	bool isEllipse = false;
+	bool isPoint = false;
+	uint32_t firstProperty = 0;
+	uint32_t propertyCount = 0;
+	uint32_t firstPoint = 0;
+	uint32_t pointCount = 0;
+};
+
+/**
+ * The objects of an object group.
+ * Strings are interned once per group and properties and polygon points are kept in flat pools, so thousands of objects
+ * take a few allocations and can be scanned without following pointers.
+ */
+class TileObjectGroup {
+public:
+	static constexpr uint32_t no_string = UINT32_MAX;
+
 	std::string name;
-	std::vector<TileObject> objects;
+	std::vector<ObjectRecord> objects;
 	double opacity = 1.0;
+
+	/**
+	 * Adds a copy of the object. The strings are interned
+	 * @return The stored object. Valid until the next object is added
+	 */
+	const ObjectRecord& add(const TileObject& object) {
+		ObjectRecord record;
+		record.id = object.id;
+		record.x = object.x;
+		record.y = object.y;
+		record.width = object.width;
+		record.height = object.height;
+		record.name = intern(object.name);
+		record.type = intern(object.type);
+		record.kind = objectTypeFromName(object.type);
+		record.isEllipse = object.isEllipse;
+		record.isPoint = object.isPoint;
+		record.firstProperty = properties_.size();
+		record.propertyCount = object.properties.size();
+		for (const auto& prop : object.properties) {
+			ObjectProperty property;
+			property.name = intern(prop.first);
+			property.type = intern(prop.second.type);
+			property.value = intern(prop.second.value);
+			properties_.push_back(property);
+		}
+		record.firstPoint = points_.size();
+		record.pointCount = object.polygon_points.size();
+		points_.insert(points_.end(), object.polygon_points.begin(), object.polygon_points.end());
+		objects.push_back(record);
+		return objects.back();
+	}
+
+	/**
+	 * @return A copy of an object with its own strings
+	 */
+	TileObject get(size_t index) const {
+		const ObjectRecord& record = objects.at(index);
+		TileObject ret;
+		ret.id = record.id;
+		ret.name = str(record.name);
+		ret.type = str(record.type);
+		ret.x = record.x;
+		ret.y = record.y;
+		ret.width = record.width;
+		ret.height = record.height;
+		ret.isEllipse = record.isEllipse;
+		ret.isPoint = record.isPoint;
+		for (const ObjectProperty& property : properties(record)) {
+			TileProperty& tp = ret.properties[str(property.name)];
+			tp.name = str(property.name);
+			tp.type = str(property.type);
+			tp.value = str(property.value);
+		}
+		const std::span<const std::pair<int, int> > polygon = points(record);
+		ret.polygon_points.assign(polygon.begin(), polygon.end());
+		return ret;
+	}
+
+	const std::string& str(uint32_t id) const {
+		return strings_.at(id);
+	}
+
+	/**
+	 * @return The id of the string. The string is added if it is new
+	 */
+	uint32_t intern(const std::string& value) {
+		const auto itr = string_ids_.find(value);
+		if (itr != string_ids_.end()) {
+			return itr->second;
+		}
+		const uint32_t id = strings_.size();
+		strings_.push_back(value);
+		string_ids_.emplace(value, id);
+		return id;
+	}
+
+	/**
+	 * @return The id of the string or no_string if no object in the group uses it
+	 */
+	uint32_t findString(const std::string& value) const {
+		const auto itr = string_ids_.find(value);
+		if (itr == string_ids_.end()) {
+			return no_string;
+		}
+		return itr->second;
+	}
+
+	std::span<const ObjectProperty> properties(const ObjectRecord& object) const {
+		return std::span<const ObjectProperty>(properties_.data()+object.firstProperty, object.propertyCount);
+	}
+
+	std::span<const std::pair<int, int> > points(const ObjectRecord& object) const {
+		return std::span<const std::pair<int, int> >(points_.data()+object.firstPoint, object.pointCount);
+	}
+
+	/**
+	 * @return The value of the property with the given name or nullptr if the object does not have it
+	 */
+	const std::string* property(const ObjectRecord& object, const std::string& property_name) const {
+		const uint32_t id = findString(property_name);
+		if (id == no_string) {
+			return nullptr;
+		}
+		for (const ObjectProperty& property : properties(object)) {
+			if (property.name == id) {
+				return &strings_[property.value];
+			}
+		}
+		return nullptr;
+	}
+
+	/**
+	 * Removes all objects and empties the pools
+	 */
+	void clear() {
+		objects.clear();
+		properties_.clear();
+		points_.clear();
+		strings_.assign(1, "");
+		string_ids_.clear();
+		string_ids_.emplace("", 0);
+	}
+
+private:
+	std::vector<std::string> strings_ = {""};
+	std::unordered_map<std::string, uint32_t> string_ids_ = {{"", 0}};
+	std::vector<ObjectProperty> properties_;
+	std::vector<std::pair<int, int> > points_;
 };
 
 
@@ -279,12 +696,472 @@ struct TileMap {
 	int tilewidth=0;
 	int tileheight=0;
 	int nextobjectid = 0;
+	int compressionlevel = -1;  //< Level passed to the layer compression. -1 for the default of the compression
+	bool infinite = false;  //< Stored as chunks in the file. The layers cover the chunks that were in the file
+	int originx = 0;  //< Tiled tile coordinates of the tile at (0,0) in the layers. Only infinite maps have an origin
+	int originy = 0;
 	std::vector<TileSet> tileset;
 	std::vector<TileLayer> layers;
 	std::vector<TileObjectGroup> object_groups;
 	std::map<std::string, TileProperty> properties;
 };
 
+/**
+ * Parses csv encoded gids.
+ * @param tile_count The number of gids that data must contain
+ * @param tiles Receives the gids
+ * @param name Name of the layer. Only used for error messages
+ */
+inline void parse_csv_tiles(const char* data, size_t length, size_t tile_count, std::vector<uint32_t>& tiles, const std::string& name) {
+	tiles.assign(tile_count, 0);
+	size_t tile = 0;
+	size_t pos = 0;
+	while (pos < length) {
+		if (data[pos] < '0' || data[pos] > '9') {
+			++pos;
+			continue;
+		}
+		uint32_t gid = 0;
+		while (pos < length && data[pos] >= '0' && data[pos] <= '9') {
+			gid = gid*10 + (data[pos]-'0');
+			++pos;
+		}
+		if (tile >= tile_count) {
+			throw SagoTiledException("Layer %s has more than %lu tiles", name.c_str(), (unsigned long)tile_count);
+		}
+		tiles[tile] = gid;
+		++tile;
+	}
+	if (tile != tile_count) {
+		throw SagoTiledException("Layer %s has %lu tiles, expected %lu", name.c_str(), (unsigned long)tile, (unsigned long)tile_count);
+	}
+}
+
+/**
+ * Parses the text of a csv encoded <data> node into the tiles of a layer.
+ * The layer width and height must already be set.
+ * @param tiles Reusable buffer for the parsed tiles
+ */
+inline void decode_layer_csv(const char* data, size_t length, TileLayer& tl, std::vector<uint32_t>& tiles) {
+	parse_csv_tiles(data, length, (size_t)tl.width*tl.height, tiles, tl.name);
+	tl.data.tiles.resize(tl.width, tl.height);
+	tl.data.tiles.assign(tiles.data());
+}
+
+/**
+ * Decodes the text of a <data> node directly into the tiles of a layer.
+ * The layer width, height, encoding and compression must already be set. The compressed bytes and the decompressed tiles
+ * are kept in the scratch buffers, so the node text is never copied and only chunks with tiles are allocated.
+ * @param data csv or base64 encoded data. Need not be null terminated.
+ * @param length Length of data
+ * @param tl The layer to decode into
+ * @param scratch Reusable buffers for the intermediate data
+ */
+inline void decode_layer_data(const char* data, size_t length, TileLayer& tl, TmxParseScratch& scratch) {
+	if (tl.width <= 0 || tl.height <= 0) {
+		throw SagoTiledException("Layer %s has no size", tl.name.c_str());
+	}
+	if (tl.data.encoding == "csv") {
+		decode_layer_csv(data, length, tl, scratch.tiles);
+		return;
+	}
+	if (tl.data.encoding != "base64") {
+		throw SagoTiledException("Unsupported layer encoding: \"%s\"", tl.data.encoding.c_str());
+	}
+	const LayerCompression& compression = getLayerCompression(tl.data.compression);
+	if (scratch.decoded.size() < base64_decoded_max_length(length)) {
+		scratch.decoded.resize(base64_decoded_max_length(length));
+	}
+	const size_t decoded_length = base64_decode(data, length, scratch.decoded.data());
+	if (decoded_length == 0) {
+		std::cerr << "Warning: Layer without data... this is most likely a mistake.\n";
+		tl.data.tiles = TileGrid();
+		return;
+	}
+	scratch.tiles.resize((size_t)tl.width*tl.height);
+	compression.decompress(scratch.decoded.data(), decoded_length, reinterpret_cast<char*>(scratch.tiles.data()), scratch.tiles.size()*sizeof(uint32_t));
+	tl.data.tiles.resize(tl.width, tl.height);
+	tl.data.tiles.assign(scratch.tiles.data());
+	if (tl.data.compression.length()) {
+		tl.data.setStoredBytes(scratch.decoded.data(), decoded_length);
+	}
+}
+
+/**
+ * Rounds down to a multiple of TileChunk::size. Also for negative numbers
+ */
+inline int chunk_floor(int value) {
+	const int size = TileChunk::size;
+	return (value >= 0 ? value/size : -((-value+size-1)/size))*size;
+}
+
+/**
+ * Decompresses a pending chunk.
+ * @param tiles Room for TileChunk::size*TileChunk::size tiles
+ */
+inline void decode_pending_chunk(const PendingChunk& chunk, uint32_t* tiles) {
+	const size_t length = TileChunk::size*TileChunk::size*sizeof(uint32_t);
+	getLayerCompression(chunk.compression).decompress(chunk.bytes.data(), chunk.bytes.size(), reinterpret_cast<char*>(tiles), length);
+}
+
+/**
+ * Adds a chunk of an infinite map to a layer.
+ * Chunks that match a chunk of the tile grid are kept compressed as pending chunks. Other chunks are decoded right away.
+ * The layer must already have its final size.
+ * @param tl The layer
+ * @param x X coordinate of the top left tile in the layer
+ * @param y Y coordinate of the top left tile in the layer
+ * @param w Width in tiles
+ * @param h Height in tiles
+ * @param data The tiles compressed with compression
+ * @param length Length of data
+ * @param compression The compression of data
+ * @param tiles Reusable buffer for decoded tiles
+ */
+inline void add_layer_chunk(TileLayer& tl, int x, int y, int w, int h, const char* data, size_t length, const std::string& compression,
+		std::vector<uint32_t>& tiles) {
+	const int size = TileChunk::size;
+	if (w <= 0 || h <= 0 || x < 0 || y < 0 || x+w > tl.data.tiles.width() || y+h > tl.data.tiles.height()) {
+		throw SagoTiledException("Chunk (%d, %d) of layer %s is outside the layer", x, y, tl.name.c_str());
+	}
+	if (w == size && h == size && x % size == 0 && y % size == 0) {
+		std::shared_ptr<PendingChunk> pending = std::make_shared<PendingChunk>();
+		pending->compression = compression;
+		pending->bytes.assign(data, length);
+		tl.data.pending_chunks[std::make_pair(x/size, y/size)] = pending;
+		return;
+	}
+	tiles.resize((size_t)w*h);
+	getLayerCompression(compression).decompress(data, length, reinterpret_cast<char*>(tiles.data()), tiles.size()*sizeof(uint32_t));
+	tl.data.tiles.assignRect(x, y, w, h, tiles.data());
+}
+
+/**
+ * The position and text of a <chunk> node
+ */
+struct TmxChunkText {
+	int x = 0;
+	int y = 0;
+	int width = 0;
+	int height = 0;
+	const char* text = nullptr;
+	size_t length = 0;
+};
+
+/**
+ * Decodes the <chunk> nodes of a layer in an infinite map.
+ * The layer width, height, encoding and compression must already be set.
+ * @param chunks The chunks in Tiled tile coordinates
+ * @param tl The layer to decode into
+ * @param originx Tiled tile coordinate of the left most tile of the layer
+ * @param originy Tiled tile coordinate of the top most tile of the layer
+ * @param scratch Reusable buffers for the intermediate data
+ */
+inline void decode_layer_chunks(const std::vector<TmxChunkText>& chunks, TileLayer& tl, int originx, int originy, TmxParseScratch& scratch) {
+	tl.data.tiles.resize(tl.width, tl.height);
+	if (tl.data.encoding != "csv" && tl.data.encoding != "base64") {
+		throw SagoTiledException("Unsupported layer encoding: \"%s\"", tl.data.encoding.c_str());
+	}
+	for (const TmxChunkText& chunk : chunks) {
+		const int x = chunk.x-originx;
+		const int y = chunk.y-originy;
+		if (tl.data.encoding == "csv") {
+			parse_csv_tiles(chunk.text, chunk.length, (size_t)chunk.width*chunk.height, scratch.tiles, tl.name);
+			tl.data.tiles.assignRect(x, y, chunk.width, chunk.height, scratch.tiles.data());
+			continue;
+		}
+		if (scratch.decoded.size() < base64_decoded_max_length(chunk.length)) {
+			scratch.decoded.resize(base64_decoded_max_length(chunk.length));
+		}
+		const size_t decoded_length = base64_decode(chunk.text, chunk.length, scratch.decoded.data());
+		add_layer_chunk(tl, x, y, chunk.width, chunk.height, scratch.decoded.data(), decoded_length, tl.data.compression, scratch.tiles);
+	}
+}
+
+/**
+ * Calls func(iterator) for every pending chunk of the layer that overlaps a rectangle, until func returns false.
+ * func may erase the chunk it is given and must then return the iterator to the next chunk through the reference.
+ */
+template <class PendingChunks, class Func>
+inline void forEachPendingChunk(PendingChunks& pending, int x, int y, int w, int h, Func func) {
+	if (pending.empty() || w <= 0 || h <= 0 || x+w <= 0 || y+h <= 0) {
+		return;
+	}
+	const int size = TileChunk::size;
+	const int first_cx = std::max(x, 0)/size;
+	const int first_cy = std::max(y, 0)/size;
+	const int last_cx = (x+w-1)/size;
+	const int last_cy = (y+h-1)/size;
+	for (int cx = first_cx; cx <= last_cx; ++cx) {
+		auto itr = pending.lower_bound(std::make_pair(cx, first_cy));
+		while (itr != pending.end() && itr->first.first == cx && itr->first.second <= last_cy) {
+			if (!func(itr)) {
+				return;
+			}
+		}
+	}
+}
+
+/**
+ * @return true if the layer has pending chunks that overlap the rectangle
+ */
+inline bool hasPendingChunks(const TileLayer& l, int x, int y, int w, int h) {
+	bool ret = false;
+	forEachPendingChunk(l.data.pending_chunks, x, y, w, h, [&ret](auto&) {
+		ret = true;
+		return false;
+	});
+	return ret;
+}
+
+/**
+ * Decodes the pending chunks of a layer that overlap a rectangle.
+ * Tiles written to the grid inside a pending chunk before it is loaded are overwritten.
+ * @param l The layer
+ * @param x X coordinate of the rectangle in tiles
+ * @param y Y coordinate of the rectangle in tiles
+ * @param w Width of the rectangle in tiles
+ * @param h Height of the rectangle in tiles
+ * @return The number of chunks decoded
+ */
+inline size_t loadPendingChunks(TileLayer& l, int x, int y, int w, int h) {
+	std::map<std::pair<int, int>, std::shared_ptr<const PendingChunk> >& pending = l.data.pending_chunks;
+	const int size = TileChunk::size;
+	uint32_t tiles[size*size];
+	size_t ret = 0;
+	forEachPendingChunk(pending, x, y, w, h, [&](auto& itr) {
+		decode_pending_chunk(*itr->second, tiles);
+		l.data.tiles.assignRect(itr->first.first*size, itr->first.second*size, size, size, tiles);
+		itr = pending.erase(itr);
+		++ret;
+		return true;
+	});
+	return ret;
+}
+
+/**
+ * Decodes the pending chunks of all layers that overlap a rectangle. The layers are decoded on the layer workers.
+ * Layers without pending chunks in the rectangle are skipped up front. If nothing is pending, as near the camera once the
+ * chunks there are loaded, the workers are not involved at all.
+ * @return The number of chunks decoded
+ */
+inline size_t loadPendingChunks(TileMap& m, int x, int y, int w, int h) {
+	std::vector<size_t> layers;
+	for (size_t i = 0; i < m.layers.size(); ++i) {
+		if (hasPendingChunks(m.layers[i], x, y, w, h)) {
+			layers.push_back(i);
+		}
+	}
+	if (layers.empty()) {
+		return 0;
+	}
+	std::vector<size_t> loaded(layers.size());
+	for_each_layer(layers.size(), [&](size_t i) {
+		loaded[i] = loadPendingChunks(m.layers[layers[i]], x, y, w, h);
+	});
+	size_t ret = 0;
+	for (size_t count : loaded) {
+		ret += count;
+	}
+	return ret;
+}
+
+/**
+ * Decodes every pending chunk of the map. Needed before code that reads the whole map at once.
+ * @return The number of chunks decoded
+ */
+inline size_t loadAllPendingChunks(TileMap& m) {
+	std::vector<size_t> loaded(m.layers.size());
+	for_each_layer(m.layers.size(), [&](size_t i) {
+		const TileGrid& tiles = m.layers[i].data.tiles;
+		loaded[i] = loadPendingChunks(m.layers[i], 0, 0, tiles.width(), tiles.height());
+	});
+	size_t ret = 0;
+	for (size_t count : loaded) {
+		ret += count;
+	}
+	return ret;
+}
+
+inline bool hasPendingChunks(const TileMap& m) {
+	for (const TileLayer& l : m.layers) {
+		if (l.data.pending_chunks.size()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * A chunk of an infinite map that is ready to be written
+ */
+struct StoredChunk {
+	int x = 0;  //< X coordinate of the top left tile in the layer
+	int y = 0;  //< Y coordinate of the top left tile in the layer
+	int width = 0;
+	int height = 0;
+	std::shared_ptr<const PendingChunk> data;  //< The tiles compressed with the compression of the layer
+};
+
+/**
+ * Splits a layer of an infinite map into chunks of TileChunk::size tiles for writing. Chunks without tiles are left out.
+ * Pending chunks are written as they were read unless the compression of the layer has changed since.
+ * @param data The layer data
+ * @param level The compression level. -1 for the default of the compression
+ * @return The chunks row by row
+ */
+inline std::vector<StoredChunk> collect_layer_chunks(const TileLayerData& data, int level) {
+	std::vector<StoredChunk> ret;
+	const int size = TileChunk::size;
+	const LayerCompression& compression = getLayerCompression(data.compression);
+	uint32_t tiles[size*size];
+	for (int cy = 0; cy*size < data.tiles.height(); ++cy) {
+		for (int cx = 0; cx*size < data.tiles.width(); ++cx) {
+			StoredChunk chunk;
+			chunk.x = cx*size;
+			chunk.y = cy*size;
+			chunk.width = std::min(size, data.tiles.width()-chunk.x);
+			chunk.height = std::min(size, data.tiles.height()-chunk.y);
+			const auto pending = data.pending_chunks.find(std::make_pair(cx, cy));
+			if (pending != data.pending_chunks.end()) {
+				if (pending->second->compression == data.compression) {
+					chunk.data = pending->second;
+					ret.push_back(chunk);
+					continue;
+				}
+				decode_pending_chunk(*pending->second, tiles);  //Pending chunks are always whole chunks
+			}
+			else {
+				if (data.tiles.countNonZero(chunk.x, chunk.y, chunk.width, chunk.height) == 0) {
+					continue;
+				}
+				data.tiles.copyRectTo(chunk.x, chunk.y, chunk.width, chunk.height, tiles);
+			}
+			std::shared_ptr<PendingChunk> stored = std::make_shared<PendingChunk>();
+			stored->compression = data.compression;
+			stored->bytes = compression.compress(reinterpret_cast<const char*>(tiles), (size_t)chunk.width*chunk.height*sizeof(uint32_t), level);
+			chunk.data = stored;
+			ret.push_back(chunk);
+		}
+	}
+	return ret;
+}
+
+struct LayerBytes {
+	const char* data = nullptr;
+	size_t size = 0;
+};
+
+/**
+ * Buffers for the bytes of a layer that is being written
+ */
+struct LayerWriteScratch {
+	std::vector<uint32_t> tiles;
+	std::string compressed;
+};
+
+/**
+ * Returns the tiles in rows, compressed with the compression of the layer.
+ * Uses the stored bytes from load if they are still valid. Otherwise the tiles are copied out of the grid and compressed.
+ * @param data The layer data
+ * @param level The compression level. -1 for the default of the compression
+ * @param scratch Holds the result if it could not be reused
+ * @return The compressed data. Valid as long as data and scratch are unchanged
+ */
+inline LayerBytes compressed_layer_data(const TileLayerData& data, int level, LayerWriteScratch& scratch) {
+	if (data.compression.length() && data.hasStoredBytes()) {
+		return {data.stored_bytes.data(), data.stored_bytes.size()};
+	}
+	scratch.tiles.resize(data.tiles.size());
+	data.tiles.copyTo(scratch.tiles.data());
+	const char* tiles = reinterpret_cast<const char*>(scratch.tiles.data());
+	const size_t size = scratch.tiles.size()*sizeof(uint32_t);
+	if (data.compression.empty()) {
+		return {tiles, size};
+	}
+	scratch.compressed = getLayerCompression(data.compression).compress(tiles, size, level);
+	std::vector<uint32_t>().swap(scratch.tiles);
+	return {scratch.compressed.data(), scratch.compressed.size()};
+}
+
+/**
+ * Writes gids as csv with a line break after every row.
+ */
+inline void write_csv_tiles(std::ostream& out, const uint32_t* tiles, size_t tile_count, int width) {
+	for (size_t i = 0; i < tile_count; ++i) {
+		out << tiles[i];
+		if (i+1 < tile_count) {
+			out << ',';
+		}
+		if (width > 0 && (i+1) % width == 0) {
+			out << '\n';
+		}
+	}
+}
+
+/**
+ * Writes the tiles of a layer as the text of a <data> node, using the encoding and compression of the layer.
+ * @param out The stream to write to
+ * @param l The layer to encode
+ * @param level The compression level. -1 for the default of the compression
+ * @param compressed The result of compressed_layer_data for the layer if it is already known
+ */
+inline void write_layer_data(std::ostream& out, const TileLayer& l, int level, const LayerBytes* compressed = nullptr) {
+	if (l.data.encoding == "csv") {
+		if (l.data.compression.length()) {
+			throw SagoTiledException("csv encoded layer %s cannot be compressed", l.name.c_str());
+		}
+		std::vector<uint32_t> tiles(l.data.tiles.size());
+		l.data.tiles.copyTo(tiles.data());
+		write_csv_tiles(out, tiles.data(), tiles.size(), l.width);
+		return;
+	}
+	if (l.data.encoding != "base64") {
+		throw SagoTiledException("Unsupported layer encoding: \"%s\"", l.data.encoding.c_str());
+	}
+	if (compressed) {
+		stream_encode(out, compressed->data, compressed->size);
+		return;
+	}
+	LayerWriteScratch scratch;
+	LayerBytes bytes = compressed_layer_data(l.data, level, scratch);
+	stream_encode(out, bytes.data, bytes.size);
+}
+
+/**
+ * Returns the codec name of a layer as used by setLayerCodec
+ */
+inline std::string getLayerCodec(const TileLayerData& data) {
+	if (data.encoding == "csv") {
+		return "csv";
+	}
+	if (data.compression.empty()) {
+		return "base64";
+	}
+	return data.compression;
+}
+
+/**
+ * Chooses how the layers of the map are stored when the map is written.
+ * @param m The map to change
+ * @param codec "csv", "base64" (uncompressed) or the name of a registered compression like "zlib", "gzip" or "zstd"
+ * @param level The compression level. -1 for the default of the compression
+ */
+inline void setLayerCodec(TileMap& m, const std::string& codec, int level = -1) {
+	std::string encoding = "base64";
+	std::string compression = codec;
+	if (codec == "csv" || codec == "base64") {
+		encoding = codec;
+		compression = "";
+	}
+	getLayerCompression(compression);  // Throws if unknown
+	for (TileLayer& l : m.layers) {
+		l.data.encoding = encoding;
+		l.data.compression = compression;
+	}
+	m.compressionlevel = level;
+}
+
 inline void setValueFromAttribute(rapidxml::xml_node<> * node, const char* name, std::string& result) {
 	auto val = node->first_attribute(name);
 	if (val) {
@@ -349,28 +1226,56 @@ inline TileSet node2tileset(rapidxml::xml_node<> * tileset_node) {
 		setValueFromAttribute(tile_node, "id", t.id);
 		setValueFromAttribute(tile_node, "terrain", t.terrain);
 		setValueFromAttribute(tile_node, "probability", t.probability);
+		rapidxml::xml_node<> * properties_node = tile_node->first_node("properties");
+		if (properties_node) {
+			for (rapidxml::xml_node<> * property_node = properties_node->first_node("property");
+			property_node; property_node = property_node->next_sibling("property") ) {
+				TileProperty tp;
+				setValueFromAttribute(property_node, "name", tp.name);
+				setValueFromAttribute(property_node, "type", tp.type);
+				setValueFromAttribute(property_node, "value", tp.value);
+				t.properties[tp.name] = tp;
+			}
+		}
 		ts.tiles_map[t.id] = t;
 		ts.tiles.push_back(t);
 	}
 	return ts;
 }
 
-inline TileSet string2tileset(const std::string& tsx_content) {
-	std::string tsx_parseable_content = tsx_content;
+/**
+ * Parses a tsx file in place. The buffer is modified by the parser.
+ * @param tsx_content Null terminated buffer owned by the caller
+ */
+inline TileSet string2tileset_inplace(char* tsx_content) {
 	rapidxml::xml_document<> doc;    // character type defaults to char
-	char* parsable_pointer = &tsx_parseable_content[0];  //Legal from C++11 and forward
-	doc.parse<0>(parsable_pointer);
+	doc.parse<0>(tsx_content);
 	rapidxml::xml_node<> * root_node = doc.first_node("tileset");
+	if (!root_node) {
+		throw SagoTiledException("No tileset element found");
+	}
 	return node2tileset(root_node);
 }
 
-inline TileMap string2tilemap(const std::string& tmx_content) {
+inline TileSet string2tileset(const std::string& tsx_content) {
+	std::string tsx_parseable_content = tsx_content;
+	return string2tileset_inplace(&tsx_parseable_content[0]);  //Legal from C++11 and forward
+}
+
+/**
+ * Parses a tmx file in place. The buffer is modified by the parser and can be discarded afterwards.
+ * Layer data is decoded directly from the buffer into the layer tiles.
+ * Use this if the caller owns the buffer anyway to avoid copying the entire file.
+ * @param tmx_content Null terminated buffer owned by the caller
+ */
+inline TileMap string2tilemap_inplace(char* tmx_content) {
 	TileMap m;
-	std::string tmx_parseable_content = tmx_content;
 	rapidxml::xml_document<> doc;    // character type defaults to char
-	char* parsable_pointer = &tmx_parseable_content[0];  //Legal from C++11 and forward
-	doc.parse<0>(parsable_pointer);
+	doc.parse<0>(tmx_content);
 	rapidxml::xml_node<> * root_node = doc.first_node("map");
+	if (!root_node) {
+		throw SagoTiledException("No map element found");
+	}
 	setValueFromAttribute( root_node, "verion", m.version);
 	setValueFromAttribute( root_node, "orientation", m.orientation);
 	setValueFromAttribute( root_node, "renderorder", m.renderorder);
@@ -379,6 +1284,10 @@ inline TileMap string2tilemap(const std::string& tmx_content) {
 	setValueFromAttribute( root_node, "tilewidth", m.tilewidth);
 	setValueFromAttribute( root_node, "tileheight", m.tileheight);
 	setValueFromAttribute( root_node, "nextobjectid", m.nextobjectid);
+	setValueFromAttribute( root_node, "compressionlevel", m.compressionlevel);
+	int infinite = 0;
+	setValueFromAttribute( root_node, "infinite", infinite);
+	m.infinite = infinite;
 	rapidxml::xml_node<> * custom_properties_node = root_node->first_node("properties");
 	if (custom_properties_node) {
 		for (rapidxml::xml_node<> * property_node = custom_properties_node->first_node("property");
@@ -394,6 +1303,8 @@ inline TileMap string2tilemap(const std::string& tmx_content) {
 	for (rapidxml::xml_node<> * tileset_node = root_node->first_node("tileset"); tileset_node; tileset_node = tileset_node->next_sibling("tileset")) {
 		m.tileset.push_back(node2tileset(tileset_node));
 	}
+	std::vector<std::pair<const char*, size_t> > layer_text;  //Decoded on the layer workers once all layers are read
+	std::vector<std::vector<TmxChunkText> > layer_chunks;  //Same for infinite maps
 	for (rapidxml::xml_node<> * layer_node = root_node->first_node("layer"); layer_node; layer_node = layer_node->next_sibling("layer")) {
 		TileLayer tl;
 		setValueFromAttribute(layer_node, "name", tl.name);
@@ -401,11 +1312,57 @@ inline TileMap string2tilemap(const std::string& tmx_content) {
 		setValueFromAttribute(layer_node, "width", tl.width);
 		const auto& data_node = getElement(layer_node, "data");
 		setValueFromAttribute(data_node, "encoding", tl.data.encoding);
+		tl.data.compression.clear();  // No attribute means uncompressed
 		setValueFromAttribute(data_node, "compression", tl.data.compression);
-		std::string compressed_payload = data_node->value();
-		tl.data.payload = sago::tiled::string_decompress_decode(compressed_payload);
-		m.layers.push_back(tl);
+		layer_text.emplace_back(data_node->value(), data_node->value_size());
+		std::vector<TmxChunkText> chunks;
+		for (rapidxml::xml_node<> * chunk_node = data_node->first_node("chunk"); chunk_node; chunk_node = chunk_node->next_sibling("chunk")) {
+			TmxChunkText chunk;
+			setValueFromAttribute(chunk_node, "x", chunk.x);
+			setValueFromAttribute(chunk_node, "y", chunk.y);
+			setValueFromAttribute(chunk_node, "width", chunk.width);
+			setValueFromAttribute(chunk_node, "height", chunk.height);
+			chunk.text = chunk_node->value();
+			chunk.length = chunk_node->value_size();
+			chunks.push_back(chunk);
+		}
+		layer_chunks.push_back(std::move(chunks));
+		m.layers.push_back(std::move(tl));
+	}
+	if (m.infinite) {
+		//Every layer covers all chunks of the map. The origin is aligned to the tile grid chunks, so the chunks of Tiled
+		//(16x16 by default) can stay compressed until they are needed
+		int left = INT_MAX;
+		int top = INT_MAX;
+		int right = INT_MIN;
+		int bottom = INT_MIN;
+		for (const std::vector<TmxChunkText>& chunks : layer_chunks) {
+			for (const TmxChunkText& chunk : chunks) {
+				left = std::min(left, chunk.x);
+				top = std::min(top, chunk.y);
+				right = std::max(right, chunk.x+chunk.width);
+				bottom = std::max(bottom, chunk.y+chunk.height);
+			}
+		}
+		if (left <= right) {
+			m.originx = chunk_floor(left);
+			m.originy = chunk_floor(top);
+			m.width = right-m.originx;
+			m.height = bottom-m.originy;
+		}
+		for (TileLayer& l : m.layers) {
+			l.width = m.width;
+			l.height = m.height;
+		}
 	}
+	for_each_layer(m.layers.size(), [&](size_t i) {
+		thread_local TmxParseScratch scratch;
+		if (m.infinite) {
+			decode_layer_chunks(layer_chunks[i], m.layers[i], m.originx, m.originy, scratch);
+			return;
+		}
+		decode_layer_data(layer_text[i].first, layer_text[i].second, m.layers[i], scratch);
+	});
 	for (rapidxml::xml_node<> * object_group_node = root_node->first_node("objectgroup"); object_group_node; object_group_node = object_group_node->next_sibling("objectgroup") ) {
 		TileObjectGroup group;
 		setValueFromAttribute(object_group_node, "name", group.name);
@@ -419,6 +1376,8 @@ inline TileMap string2tilemap(const std::string& tmx_content) {
 			setValueFromAttribute(object_node, "y", to.y);
 			setValueFromAttribute(object_node, "width", to.width);
 			setValueFromAttribute(object_node, "height", to.height);
+			to.x -= m.originx*m.tilewidth;  //Objects are relative to the layers
+			to.y -= m.originy*m.tileheight;
 			getElement(object_node, "ellipse", to.isEllipse);
 			getElement(object_node, "point", to.isPoint);
 			bool isPolygon = false;
@@ -452,26 +1411,31 @@ inline TileMap string2tilemap(const std::string& tmx_content) {
 					to.properties[tp.name] = tp;
 				}
 			}
-			group.objects.push_back(to);
+			group.add(to);
 		}
-		m.object_groups.push_back(group);
+		m.object_groups.push_back(std::move(group));
 	}
 	return m;
 }
 
-inline void xml_add_attribute(std::iostream& io, const std::string& name, const std::string& value) {
+inline TileMap string2tilemap(const std::string& tmx_content) {
+	std::string tmx_parseable_content = tmx_content;
+	return string2tilemap_inplace(&tmx_parseable_content[0]);  //Legal from C++11 and forward
+}
+
+inline void xml_add_attribute(std::ostream& io, const std::string& name, const std::string& value) {
 	if (value.length()) {
 		io << " " << name << "=\"" << value << "\"";
 	}
 }
 
-inline void xml_add_attribute(std::iostream& io, const char* name, int value) {
+inline void xml_add_attribute(std::ostream& io, const char* name, int value) {
 	if (value) {
 		io << " " << name << "=\"" << value << "\"";
 	}
 }
 
-inline void xml_add_tileset(std::iostream& io, const TileMap& m, size_t tile_set_number) {
+inline void xml_add_tileset(std::ostream& io, const TileMap& m, size_t tile_set_number) {
 	const auto& ts = m.tileset.at(tile_set_number);
 	io << "<tileset";
 	xml_add_attribute(io, "firstgid", ts.firstgid);
@@ -488,33 +1452,72 @@ inline void xml_add_tileset(std::iostream& io, const TileMap& m, size_t tile_set
 	io << "</tileset>\n";
 }
 
-inline void xml_add_layer(std::iostream& io, const TileMap& m, size_t layer_number) {
+/**
+ * Writes the chunks of a layer in an infinite map as <chunk> nodes.
+ */
+inline void xml_add_chunks(std::ostream& io, const TileMap& m, const TileLayer& l, const std::vector<StoredChunk>& chunks) {
+	std::vector<uint32_t> tiles;
+	for (const StoredChunk& chunk : chunks) {
+		io << "<chunk x=\"" << chunk.x+m.originx << "\" y=\"" << chunk.y+m.originy << "\" width=\"" << chunk.width << "\" height=\"" << chunk.height << "\">\n";
+		if (l.data.encoding == "csv") {
+			if (l.data.compression.length()) {
+				throw SagoTiledException("csv encoded layer %s cannot be compressed", l.name.c_str());
+			}
+			tiles.resize(chunk.data->bytes.size()/sizeof(uint32_t));
+			memcpy(tiles.data(), chunk.data->bytes.data(), tiles.size()*sizeof(uint32_t));
+			write_csv_tiles(io, tiles.data(), tiles.size(), chunk.width);
+		}
+		else {
+			stream_encode(io, chunk.data->bytes.data(), chunk.data->bytes.size());
+		}
+		io << "</chunk>\n";
+	}
+}
+
+/**
+ * Writes a layer as a <layer> node.
+ * @param compressed The result of compressed_layer_data for the layer if it is already known
+ * @param chunks The result of collect_layer_chunks for the layer if the map is infinite and the chunks are already known
+ */
+inline void xml_add_layer(std::ostream& io, const TileMap& m, size_t layer_number, const LayerBytes* compressed = nullptr,
+		const std::vector<StoredChunk>* chunks = nullptr) {
 	const TileLayer& l = m.layers.at(layer_number);
 	io << "<layer";
 	xml_add_attribute(io, "name", l.name);
 	xml_add_attribute(io, "height", l.height);
 	xml_add_attribute(io, "width", l.width);
 	io << ">\n";
-	io << "<data encoding=\"base64\" compression=\"zlib\">\n";
-	io << string_encode(zlib_compress(l.data.payload));
+	io << "<data";
+	xml_add_attribute(io, "encoding", l.data.encoding);
+	xml_add_attribute(io, "compression", l.data.compression);
+	io << ">\n";
+	if (m.infinite && chunks) {
+		xml_add_chunks(io, m, l, *chunks);
+	}
+	else if (m.infinite) {
+		xml_add_chunks(io, m, l, collect_layer_chunks(l.data, m.compressionlevel));
+	}
+	else {
+		write_layer_data(io, l, m.compressionlevel, compressed);
+	}
 	io << "</data>\n";
 	io << "</layer>\n";
 }
 
-inline void xml_add_objectgroup(std::iostream& io, const TileMap& m, size_t object_group_number) {
+inline void xml_add_objectgroup(std::ostream& io, const TileMap& m, size_t object_group_number) {
 	const TileObjectGroup& tog = m.object_groups.at(object_group_number);
 	io << "<objectgroup name=\"" << tog.name << "\" opacity=\"" << tog.opacity << "\"";
 	io << ">\n";
-	for (const TileObject& to : tog.objects) {
+	for (const ObjectRecord& to : tog.objects) {
 		io << "<object";
 		io << " id=\"" << to.id << "\"";
-		if (to.name.length() > 0) {
-			io << " name=\"" << to.name << "\"";
+		if (tog.str(to.name).length() > 0) {
+			io << " name=\"" << tog.str(to.name) << "\"";
 		}
-		if (to.type.length() > 0) {
-			io << " type=\"" << to.type << "\"";
+		if (tog.str(to.type).length() > 0) {
+			io << " type=\"" << tog.str(to.type) << "\"";
 		}
-		io << " x=\"" << to.x << "\" y=\"" << to.y << "\" width=\"" << to.width << "\" height=\"" << to.height << "\"";
+		io << " x=\"" << to.x+m.originx*m.tilewidth << "\" y=\"" << to.y+m.originy*m.tileheight << "\" width=\"" << to.width << "\" height=\"" << to.height << "\"";
 		io << ">\n";
 		if (to.isEllipse) {
 			io << "<ellipse/>\n";
@@ -522,24 +1525,25 @@ inline void xml_add_objectgroup(std::iostream& io, const TileMap& m, size_t obje
 		if (to.isPoint) {
 			io << "<point/>\n";
 		}
-		if (to.polygon_points.size() > 0) {
+		const std::span<const std::pair<int, int> > polygon_points = tog.points(to);
+		if (polygon_points.size() > 0) {
 			io << "<polygon points=\"";
-			for (size_t i=0; i < to.polygon_points.size(); ++i) {
+			for (size_t i=0; i < polygon_points.size(); ++i) {
 				if (i!=0) {
 					io << " ";
 				}
-				io << to.polygon_points.at(i).first << "," << to.polygon_points.at(i).second;
+				io << polygon_points[i].first << "," << polygon_points[i].second;
 			}
 			io << "\"/>\n";
 		}
-		if (to.properties.size() > 0) {
+		if (to.propertyCount > 0) {
 			io << "<properties>\n";
-			for (const auto& prop : to.properties) {
-				io << "<property name=\"" << prop.first << "\" ";
-				if (prop.second.type.size()> 0) {
-					io << "type=\"" << prop.second.type << "\" ";
+			for (const ObjectProperty& prop : tog.properties(to)) {
+				io << "<property name=\"" << tog.str(prop.name) << "\" ";
+				if (tog.str(prop.type).size()> 0) {
+					io << "type=\"" << tog.str(prop.type) << "\" ";
 				}
-				io << "value=\"" << prop.second.value << "\" ";
+				io << "value=\"" << tog.str(prop.value) << "\" ";
 				io << "/>\n";
 			}
 			io << "</properties>\n";
@@ -549,9 +1553,13 @@ inline void xml_add_objectgroup(std::iostream& io, const TileMap& m, size_t obje
 	io << "</objectgroup>\n";
 }
 
-inline std::string tilemap2string(const TileMap& m) {
+/**
+ * Writes the map as TMX to a stream. Layers are encoded one at a time directly into the stream.
+ * @param ret The stream to write to
+ * @param m The map to write
+ */
+inline void tilemap2stream(std::ostream& ret, const TileMap& m) {
 	//Assuming UTF-8 because rapidxml ignores it.
-	std::stringstream ret;
 	ret << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
 	ret << "<map version=\"1.0\"";
 	xml_add_attribute(ret,  "orientation", m.orientation);
@@ -561,6 +1569,10 @@ inline std::string tilemap2string(const TileMap& m) {
 	xml_add_attribute(ret,  "tilewidth", m.tilewidth);
 	xml_add_attribute(ret,  "tileheight", m.tileheight);
 	xml_add_attribute(ret,  "nextobjectid", m.nextobjectid);
+	if (m.compressionlevel != -1) {
+		ret << " compressionlevel=\"" << m.compressionlevel << "\"";
+	}
+	xml_add_attribute(ret,  "infinite", m.infinite ? 1 : 0);
 	ret << ">\n";
 	if (m.properties.size() > 0) {
 		ret << "<properties>\n";
@@ -577,13 +1589,30 @@ inline std::string tilemap2string(const TileMap& m) {
 	for (size_t i = 0; i < m.tileset.size(); ++i) {
 		xml_add_tileset(ret, m, i);
 	}
+	//Compress on the layer workers. Only the base64 encoding is left for the stream
+	std::vector<LayerWriteScratch> scratch(m.layers.size());
+	std::vector<LayerBytes> compressed(m.layers.size());
+	std::vector<std::vector<StoredChunk> > chunks(m.layers.size());
+	for_each_layer(m.layers.size(), [&](size_t i) {
+		if (m.infinite) {
+			chunks[i] = collect_layer_chunks(m.layers[i].data, m.compressionlevel);
+		}
+		else if (m.layers[i].data.encoding == "base64") {
+			compressed[i] = compressed_layer_data(m.layers[i].data, m.compressionlevel, scratch[i]);
+		}
+	});
 	for (size_t i = 0; i < m.layers.size(); ++i) {
-		xml_add_layer(ret, m, i);
+		xml_add_layer(ret, m, i, m.layers[i].data.encoding == "base64" ? &compressed[i] : nullptr, &chunks[i]);
 	}
 	for (size_t i = 0; i < m.object_groups.size(); ++i) {
 		xml_add_objectgroup(ret, m, i);
 	}
 	ret << "</map>\n";
+}
+
+inline std::string tilemap2string(const TileMap& m) {
+	std::stringstream ret;
+	tilemap2stream(ret, m);
 	return ret.str();
 }
 
@@ -649,50 +1678,35 @@ inline bool tileInBound(const TileMap& tm, int x, int y) {
 /**
  * This function tells the gid of the tile in a given location on a given map, on a given layer
  *
- * If the layer is corrupt or the coordinates out of bound then the behavior is unspecified.
- * It may return the wrong gid or throw a SagoTiledException
+ * Code that reads many tiles should use l.data.tiles directly.
+ * Tiles in pending chunks of an infinite map read as 0. See loadPendingChunks
  *
- * @param m The TileMap to look at. Required because the total size are located here
+ * @param m The TileMap to look at. Not used, the layer knows its own size
  * @param l The layer to look at
  * @param x The X coordinate
  * @param y The Y coordinate
- * @return The gid number of the given tile. Provided that X and Y are within the map limits
+ * @return The gid number of the given tile or 0 if X and Y are outside the layer
  */
 inline uint32_t getTileFromLayer(const TileMap& m, const TileLayer& l, int x, int y) {
-	size_t tile_index = (m.height*y+x)*sizeof(uint32_t);
-	if (tile_index > l.data.payload.size()-sizeof(uint32_t) ) {
-		return 0;
-		/*throw SagoTiledException("ERROR: getTileFromLayer called with coordinates out-of-bound. Called with (%d, %d). Limit (%d, %d). Or the layer is corrupt. "
-				"Reported number of tiles in layer: %ld", x, y, m.width-1, m.height-1, (long int)l.data.payload.size()/sizeof(uint32_t));*/
-	}
-	const unsigned char *data = reinterpret_cast<const unsigned char*>(l.data.payload.data());
-	uint32_t global_tile_id = data[tile_index] |
-				data[tile_index + 1] << 8 |
-				data[tile_index + 2] << 16 |
-				data[tile_index + 3] << 24;
-	return global_tile_id;
+	(void)m;
+	return l.data.tiles.get(x, y);
 }
 
 inline TileLayer createEmptyLayerForMap(const TileMap& tm) {
 	TileLayer t;
 	t.width = tm.width;
 	t.height = tm.height;
-	t.data.payload.resize(t.width*t.height*sizeof(uint32_t));
-	std::string& data = t.data.payload;
-	memset(&data[0], 0, data.size());
+	t.data.tiles.resize(t.width, t.height);
 	return t;
 }
 
 inline void setTileOnLayerNumber(TileMap& m, int layer_number, int x, int y, uint32_t tile) {
-	size_t tile_index = (m.height*y+x)*sizeof(uint32_t);
 	TileLayer& l = m.layers.at(layer_number);
-	if (tile_index > l.data.payload.size()-sizeof(uint32_t) ) {
+	loadPendingChunks(l, x, y, 1, 1);  //Or the tile is lost when the chunk is loaded
+	if (!l.data.tiles.set(x, y, tile)) {
 		throw SagoTiledException("ERROR: setTileOnLayerNumber called with coordinates out-of-bound. Called with (%d, %d). Limit (%d, %d). Or the layer is corrupt. "
-				"Reported number of tiles in layer: %ld", x, y, m.width-1, m.height-1, (long int)l.data.payload.size()/sizeof(uint32_t));
+				"Reported number of tiles in layer: %ld", x, y, l.data.tiles.width()-1, l.data.tiles.height()-1, (long int)l.data.tiles.size());
 	}
-	std::string& data = l.data.payload;
-	uint32_t* dp = reinterpret_cast<uint32_t*> (&data[tile_index]);
-	*dp = tile;
 }
 
 }  //tiled
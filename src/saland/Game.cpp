@@ -26,12 +26,14 @@ https://github.com/sago007/saland
 #include "GameDraw.hpp"
 #include "GameUpdates.hpp"
 #include "GameRegion.hpp"
+#include "SaveQueue.hpp"
+#include "RegionBenchmark.hpp"
 #include "Game.hpp"
 #include "GameShop.hpp"
 #include "GameItems.hpp"
 #include "GameInventoryState.hpp"
 #include "model/World.hpp"
-#include "../sagotmx/tmx_struct.h"
+#include "../sagotmx/tmx_binary.h"
 #include "../sago/SagoMisc.hpp"
 #include "../sago/SagoTextField.hpp"
 #include "globals.hpp"
@@ -57,6 +59,49 @@ https://github.com/sago007/saland
 
 int32 velocityIterations = 6;
 int32 positionIterations = 2;
+static const float simulationTickMs = 1000.0f/60.0f;  //< The simulation runs at a fixed 60 Hz no matter the frame rate
+static const int maxCatchUpTicks = 5;  //< Ticks per frame at most. After a long hitch the simulation skips ahead instead
+
+/**
+ * Physics level of detail. Creatures far from the player are frozen: Their bodies are disabled, so they leave the broadphase
+ * and the step, and they are not updated at all. A creature is frozen beyond physics_active_radius tiles and woken again
+ * physics_lod_hysteresis tiles closer, so one moving along the edge does not flip every tick.
+ * @return true if the creature is active
+ */
+static bool UpdatePhysicsLod(Creature& creature, const Human& player, const WorldSettings& settings) {
+	if (!creature.body) {
+		return true;
+	}
+	const float dx = creature.X - player.X;
+	const float dy = creature.Y - player.Y;
+	const float distance = std::sqrt(dx*dx+dy*dy)/32.0f;
+	const bool lod = settings.physics_active_radius > 0.0f;
+	if (creature.body->IsEnabled() && lod && distance > settings.physics_active_radius) {
+		creature.body->SetEnabled(false);
+	}
+	else if (!creature.body->IsEnabled() && (!lod || distance < settings.physics_active_radius-settings.physics_lod_hysteresis)) {
+		creature.body->SetEnabled(true);
+	}
+	return creature.body->IsEnabled();
+}
+
+/**
+ * Where an entity is drawn: Between its positions at the last two ticks. Jumps, like entering a region, are not interpolated.
+ * @param alpha 0 for the position at the previous tick and 1 for the position now
+ */
+static float RenderX(const Placeable& p, float alpha) {
+	if (std::abs(p.X-p.prevX) > 64.0f || std::abs(p.Y-p.prevY) > 64.0f) {
+		return p.X;
+	}
+	return p.prevX+(p.X-p.prevX)*alpha;
+}
+
+static float RenderY(const Placeable& p, float alpha) {
+	if (std::abs(p.X-p.prevX) > 64.0f || std::abs(p.Y-p.prevY) > 64.0f) {
+		return p.Y;
+	}
+	return p.prevY+(p.Y-p.prevY)*alpha;
+}
 
 
 typedef std::pair<float,float> SpawnPoint;
@@ -97,6 +142,8 @@ static bool teleport = false;
 static int teleportX = 0;
 static int teleportY = 0;
 static bool openTiled = false;
+static bool layerCodecReport = false;
+static int regionBenchmarkSize = 0;  //< Size of the region to benchmark on the next draw. 0 if none
 
 struct GotoConsoleCommand : public ConsoleCommand {
 	virtual std::string getCommand() const override {
@@ -179,11 +226,48 @@ struct ConcoleCommandTiled : public ConsoleCommand {
 	}
 };
 
+struct ConsoleCommandLayerCodecs : public ConsoleCommand {
+	virtual std::string getCommand() const override {
+		return "layer_codecs";
+	}
+	virtual std::string run(const std::vector<std::string>&) override {
+		layerCodecReport = true;
+		return "Measuring layer codecs. The report is written to stdout";
+	}
+
+	virtual std::string helpMessage() const override {
+		return "Saves and loads the current region with every layer codec and reports size and speed";
+	}
+};
+
+struct ConsoleCommandRegionBenchmark : public ConsoleCommand {
+	virtual std::string getCommand() const override {
+		return "region_benchmark";
+	}
+	virtual std::string run(const std::vector<std::string>& args) override {
+		regionBenchmarkSize = 2048;
+		if (args.size() > 1) {
+			regionBenchmarkSize = string2int_trows(args[1]);
+		}
+		if (regionBenchmarkSize < 1 || regionBenchmarkSize > 2048) {
+			regionBenchmarkSize = 0;
+			return "The size must be between 1 and 2048";
+		}
+		return "Benchmarking a large region. The report is written to stdout";
+	}
+
+	virtual std::string helpMessage() const override {
+		return "Call like \"region_benchmark [size]\". Repeats the current region until it is <size> x <size> tiles (default 2048) and reports load, save, memory, edit and draw times";
+	}
+};
+
 
 static GotoConsoleCommand gcc;
 static ResetRegionConsoleCommand rrcc;
 static ShopCommand sc;
 static ConcoleCommandTiled cct;
+static ConsoleCommandLayerCodecs cc_layer_codecs;
+static ConsoleCommandRegionBenchmark cc_region_benchmark;
 static ConsoleCommandKillPlayer cc_kill_player;
 
 struct Game::GameImpl {
@@ -197,6 +281,8 @@ struct Game::GameImpl {
 	int world_mouse_y = 0;
 	char direction = 0;
 	Uint32 lastUpdate = 0;
+	float tickAccumulator = 0.0f;  //< Milliseconds not simulated yet
+	float tickAlpha = 0.0f;  //< How far the time is between the last tick and the next. Used to interpolate the drawing
 	bool isActive = true;
 	std::string worldName = "world1";
 	sago::SagoTextField bottomField;
@@ -204,18 +290,83 @@ struct Game::GameImpl {
 	std::shared_ptr<SpellHolder> spell_holder;
 	std::shared_ptr<Console> console;
 	std::shared_ptr<GameSpellState> spellSelect;
+	GidAtlas gidAtlas;
+	std::map<std::pair<int, int>, GidAtlas> residentAtlases;  //< Atlases of the resident neighbor regions by region coordinates
 	std::shared_ptr<GameInventoryState> inventoryState;
 	bool consoleActive = false;
 	bool debugMenuActive = false;
 	int brushSize = 1; // Size of brush for tile placement/removal (1-5)
 };
 
+/**
+ * Starts loading the region the player is most likely to enter next, so crossing the border does not have to wait for it.
+ * A region is likely if the player is near its border and moving towards it or very near its border.
+ */
+static void PrefetchLikelyRegion(GameRegion& region, const Human& human, const std::string& worldName) {
+	const float prefetchDistance = 10*32.0f;
+	const float prefetchAlwaysDistance = 3*32.0f;
+	const b2Vec2 velocity = human.body ? human.body->GetLinearVelocity() : b2Vec2(0.0f, 0.0f);
+	struct Border {
+		float distance;
+		float speedTowards;
+		int dx;
+		int dy;
+	};
+	const Border borders[] = {
+		{human.X, -velocity.x, -1, 0},
+		{region.world.tm.width*32.0f-human.X, velocity.x, 1, 0},
+		{human.Y, -velocity.y, 0, -1},
+		{region.world.tm.height*32.0f-human.Y, velocity.y, 0, 1},
+	};
+	const Border* nearest = nullptr;
+	for (const Border& border : borders) {
+		const bool likely = border.distance < prefetchAlwaysDistance || (border.distance < prefetchDistance && border.speedTowards > 0.0f);
+		if (likely && (!nearest || border.distance < nearest->distance)) {
+			nearest = &border;
+		}
+	}
+	if (nearest) {
+		region.PrefetchRegion(region.GetRegionX()+nearest->dx, region.GetRegionY()+nearest->dy, worldName);
+	}
+}
+
+/**
+ * Streaming mode. Draws the layers of the resident neighbor regions next to the current region.
+ * Each region has its own tilesets and therefore its own atlas. Atlases of regions that are no longer resident are dropped.
+ */
+static void DrawResidentRegions(SDL_Renderer* target, const GameRegion& region, std::map<std::pair<int, int>, GidAtlas>& atlases, int topx, int topy) {
+	std::map<std::pair<int, int>, GidAtlas> used;
+	const sago::tiled::TileMap& current = region.world.tm;
+	for (int dy = -1; dy <= 1; ++dy) {
+		for (int dx = -1; dx <= 1; ++dx) {
+			const World* neighbor = region.GetResidentRegion(dx, dy);
+			if ((dx == 0 && dy == 0) || !neighbor) {
+				continue;
+			}
+			const sago::tiled::TileMap& tm = neighbor->tm;
+			const int offsetX = dx < 0 ? -tm.width*32 : dx*current.width*32;
+			const int offsetY = dy < 0 ? -tm.height*32 : dy*current.height*32;
+			const std::pair<int, int> key(region.GetRegionX()+dx, region.GetRegionY()+dy);
+			GidAtlas& atlas = used[key];
+			const auto itr = atlases.find(key);
+			if (itr != atlases.end()) {
+				atlas = std::move(itr->second);
+			}
+			atlas.Update(tm, globalData.spriteHolder->GetDataHolder());
+			for (size_t i = 0; i < tm.layers.size(); ++i) {
+				DrawLayer(target, atlas, tm, i, topx-offsetX, topy-offsetY, &globalData.logicalResize);
+			}
+		}
+	}
+	atlases.swap(used);
+}
+
 static SpawnPoint GetSpawnpoint(const sago::tiled::TileMap& tm) {
 	SpawnPoint ret(tm.width/2.0f, tm.height/2.0f);
 	std::vector<SpawnPoint> points;
 	for (const sago::tiled::TileObjectGroup& og : tm.object_groups) {
-		for (const sago::tiled::TileObject& o : og.objects) {
-			if (o.type == "playerStart") {
+		for (const sago::tiled::ObjectRecord& o : og.objects) {
+			if (o.kind == sago::tiled::ObjectType::playerStart) {
 				points.push_back(SpawnPoint(o.x/32.0f, o.y/32.0f));
 			}
 		}
@@ -287,13 +438,17 @@ void ApplyEquippedItems(Player& player) {
 void PlayerSave() {
 	std::string playername = Config::getInstance()->getString("player");
 	nlohmann::json j = globalData.player;
-	sago::WriteFileContent(std::format("players/{}.json", playername).c_str(), j.dump());
+	const std::string content = j.dump();
+	QueueFileWrite(std::format("players/{}.json", playername), [content](std::ostream& out) {
+		out << content;
+	});
 }
 
 void PlayerLoad() {
 	std::string playername = Config::getInstance()->getString("player");
 	nlohmann::json j;
 	std::string filename = std::format("players/{}.json", playername);
+	WaitForQueuedFile(filename);
 	if (sago::FileExists(filename.c_str())) {
 		j = nlohmann::json::parse(sago::GetFileContent(filename.c_str()));
 		globalData.player = j;
@@ -322,7 +477,7 @@ void Game::ResetWorldNoSave(int x, int y, bool forceResetWorld) {
 
 void Game::ResetWorld(int x, int y, bool forceResetWorld) {
 	PlayerSave();
-	data->gameRegion.SaveRegion();
+	data->gameRegion.FlushRegion();
 	this->ResetWorldNoSave(x, y, forceResetWorld);
 }
 
@@ -331,6 +486,8 @@ Game::Game() {
 	RegisterCommand(&rrcc);
 	RegisterCommand(&sc);
 	RegisterCommand(&cct);
+	RegisterCommand(&cc_layer_codecs);
+	RegisterCommand(&cc_region_benchmark);
 	RegisterCommand(&cc_kill_player);
 	GameConsoleCommandRegister();
 	data.reset(new Game::GameImpl());
@@ -354,6 +511,7 @@ Game::Game() {
 	data->spell_holder = std::make_shared<SpellHolder>();
 	data->spellSelect->spell_holder = data->spell_holder;
 	data->spellSelect->tm = &data->gameRegion.world.tm;
+	data->spellSelect->atlas = &data->gidAtlas;
 	data->spell_holder->init();
 	data->spell_holder->slot_spell.at(0) = data->spell_holder->get_spell_by_name("spell_fireball");
 	data->spell_holder->slot_spell.at(1) = data->spell_holder->get_spell_by_name("weapon_slash_long_knife");
@@ -370,6 +528,7 @@ Game::Game() {
 Game::~Game() {
 	data->gameRegion.SaveRegion();
 	PlayerSave();
+	WaitForAllQueuedFiles();
 }
 
 bool Game::IsActive() {
@@ -401,7 +560,7 @@ static std::string GetLayerInfoForTile(const World& w, int x, int y) {
 	}
 	for (size_t i = 0; i < w.tm.layers.size(); ++i) {
 		const sago::tiled::TileLayer& tl = w.tm.layers[i];
-		int tile = sago::tiled::getTileFromLayer(w.tm, tl, x, y);
+		uint32_t tile = tl.data.tiles.get(x, y);
 		if (tile != 0) {
 			ret << "(" << tl.name << ":" << tile << ")";
 		}
@@ -412,6 +571,26 @@ static std::string GetLayerInfoForTile(const World& w, int x, int y) {
 	return ret.str();
 }
 
+/**
+ * Sets the tile in the size*size square with the top left corner at (x,y).
+ * Protected tiles and tiles outside the layer are not changed.
+ * @return The positions that were changed
+ */
+static std::vector<std::pair<int, int>> PaintBrush(World& w, int layer_number, int x, int y, int size, uint32_t tile) {
+	std::vector<std::pair<int, int>> changed;
+	const sago::tiled::TileGrid& tiles = w.tm.layers.at(layer_number).data.tiles;
+	for (int tile_y = y; tile_y < y + size; ++tile_y) {
+		for (int tile_x = x; tile_x < x + size; ++tile_x) {
+			if (tiles.inBounds(tile_x, tile_y) && !w.tile_protected(tile_x, tile_y)) {
+				// Loads the chunk first if it is still pending. Otherwise the tile would be overwritten when it loads
+				sago::tiled::setTileOnLayerNumber(w.tm, layer_number, tile_x, tile_y, tile);
+				changed.emplace_back(tile_x, tile_y);
+			}
+		}
+	}
+	return changed;
+}
+
 static void DrawDebugMenu(SDL_Renderer*) {
 	ImGui::Begin("Debug menu");
 	//ImGui::Text("Hello, world!");
@@ -427,35 +606,48 @@ static void DrawDebugMenu(SDL_Renderer*) {
 }
 
 void Game::Draw(SDL_Renderer* target) {
+	if (regionBenchmarkSize) {
+		// Done here as the draw timings need the renderer. The frame is drawn over afterwards
+		RunRegionBenchmark(target, data->gameRegion.world.tm, regionBenchmarkSize);
+		regionBenchmarkSize = 0;
+	}
 	// Use logical coordinates for game rendering (1920x1080 as set in main)
 	double screen_width = 1280;
 	double screen_height = 720;
 	int screen_boarder = 64;
 	data->topx = std::round(data->center_x - screen_width / 2.0);
 	data->topy = std::round(data->center_y - screen_height / 2.0);
-	if (data->topx < -screen_boarder) {
-		data->topx = -screen_boarder;
-	}
-	if (data->topy < -screen_boarder) {
-		data->topy = -screen_boarder;
-	}
-	if (data->topx+screen_width > data->gameRegion.world.tm.width*32+screen_boarder) {
-		data->topx=data->gameRegion.world.tm.width*32+screen_boarder-screen_width;
-	}
-	if (data->topy+screen_height > data->gameRegion.world.tm.height*32+screen_boarder) {
-		data->topy = data->gameRegion.world.tm.height*32+screen_boarder-screen_height;
+	const bool streaming = data->gameRegion.settings.streaming;
+	// When streaming the neighbors are drawn beyond the borders, so the camera just follows the player
+	if (!streaming) {
+		if (data->topx < -screen_boarder) {
+			data->topx = -screen_boarder;
+		}
+		if (data->topy < -screen_boarder) {
+			data->topy = -screen_boarder;
+		}
+		if (data->topx+screen_width > data->gameRegion.world.tm.width*32+screen_boarder) {
+			data->topx=data->gameRegion.world.tm.width*32+screen_boarder-screen_width;
+		}
+		if (data->topy+screen_height > data->gameRegion.world.tm.height*32+screen_boarder) {
+			data->topy = data->gameRegion.world.tm.height*32+screen_boarder-screen_height;
+		}
 	}
 	data->human->pants = globalData.player.get_visible_bottom();
 	data->human->hair = globalData.player.get_visible_hair();
 	data->human->race = globalData.player.get_visible_race();
 	data->human->top = globalData.player.get_visible_top();
 	std::sort(data->gameRegion.placeables.begin(), data->gameRegion.placeables.end(),sort_placeable);
-	SDL_Texture* texture = globalData.spriteHolder->GetDataHolder().getTexturePtr("terrain");
-	DrawOuterBorder(target, texture, data->gameRegion.world.tm, data->topx, data->topy, data->gameRegion.outerTile, &globalData.logicalResize);
+	data->gidAtlas.Update(data->gameRegion.world.tm, globalData.spriteHolder->GetDataHolder());
+	// In streaming mode the border shows where a neighbor cannot be drawn yet
+	DrawOuterBorder(target, data->gidAtlas, data->gameRegion.world.tm, data->topx, data->topy, data->gameRegion.outerTile, &globalData.logicalResize);
+	if (streaming) {
+		DrawResidentRegions(target, data->gameRegion, data->residentAtlases, data->topx, data->topy);
+	}
 	for (size_t i = 0; i < data->gameRegion.world.tm.layers.size(); ++i) {
 		const std::string& layerName = data->gameRegion.world.tm.layers.at(i).name;
 		if (layerName.find("overlay",0) == std::string::npos || layerName.find("ground",0) != std::string::npos) {
-			DrawLayer(target, globalData.spriteHolder.get(), data->gameRegion.world.tm, i, data->topx, data->topy, &globalData.logicalResize);
+			DrawLayer(target, data->gidAtlas, data->gameRegion.world.tm, i, data->topx, data->topy, &globalData.logicalResize);
 		}
 	}
 	for (size_t i = 0; i < data->gameRegion.world.tm.object_groups.size(); ++i) {
@@ -474,30 +666,33 @@ void Game::Draw(SDL_Renderer* target) {
 	}
 	//Draw
 	for (const auto& p : data->gameRegion.placeables) {
+		// Moves the sprite from where the entity is to where it is drawn between the last two ticks
+		const int offsetX = data->topx + std::round(p->X - RenderX(*p, data->tickAlpha));
+		const int offsetY = data->topy + std::round(p->Y - RenderY(*p, data->tickAlpha));
 		MiscItem* m = dynamic_cast<MiscItem*> (p.get());
 		if (m) {
-			DrawMiscEntity(target, globalData.spriteHolder.get(), m, SDL_GetTicks(), data->topx, data->topy, globalData.debugDrawCollision, &globalData.logicalResize);
-			DrawDamageNumbers(target, m, data->topx, data->topy, &globalData.logicalResize);
+			DrawMiscEntity(target, globalData.spriteHolder.get(), m, SDL_GetTicks(), offsetX, offsetY, globalData.debugDrawCollision, &globalData.logicalResize);
+			DrawDamageNumbers(target, m, offsetX, offsetY, &globalData.logicalResize);
 		}
 		Human* h = dynamic_cast<Human*> (p.get());
 		if (h) {
-			DrawHumanEntity(target, globalData.spriteHolder.get(), h, SDL_GetTicks(), data->topx, data->topy, globalData.debugDrawCollision, &globalData.logicalResize);
-			DrawDamageNumbers(target, h, data->topx, data->topy, &globalData.logicalResize);
+			DrawHumanEntity(target, globalData.spriteHolder.get(), h, SDL_GetTicks(), offsetX, offsetY, globalData.debugDrawCollision, &globalData.logicalResize);
+			DrawDamageNumbers(target, h, offsetX, offsetY, &globalData.logicalResize);
 		}
 		Monster* monster = dynamic_cast<Monster*> (p.get());
 		if (monster) {
-			DrawMonster(target, globalData.spriteHolder.get(), monster, SDL_GetTicks(), data->topx, data->topy, globalData.debugDrawCollision, &globalData.logicalResize);
-			DrawDamageNumbers(target, monster, data->topx, data->topy, &globalData.logicalResize);
+			DrawMonster(target, globalData.spriteHolder.get(), monster, SDL_GetTicks(), offsetX, offsetY, globalData.debugDrawCollision, &globalData.logicalResize);
+			DrawDamageNumbers(target, monster, offsetX, offsetY, &globalData.logicalResize);
 		}
 		Projectile* projectile = dynamic_cast<Projectile*> (p.get());
 		if (projectile) {
-			DrawProjectile(target, globalData.spriteHolder.get(), projectile, SDL_GetTicks(), data->topx, data->topy, globalData.debugDrawCollision, &globalData.logicalResize);
+			DrawProjectile(target, globalData.spriteHolder.get(), projectile, SDL_GetTicks(), offsetX, offsetY, globalData.debugDrawCollision, &globalData.logicalResize);
 		}
 	}
 	for (size_t i = 0; i < data->gameRegion.world.tm.layers.size(); ++i) {
 		const std::string& layerName = data->gameRegion.world.tm.layers.at(i).name;
 		if (layerName.find("overlay",0) != std::string::npos && layerName.find("ground",0) == std::string::npos) {
-			DrawLayer(target, globalData.spriteHolder.get(), data->gameRegion.world.tm, i, data->topx, data->topy, &globalData.logicalResize);
+			DrawLayer(target, data->gidAtlas, data->gameRegion.world.tm, i, data->topx, data->topy, &globalData.logicalResize);
 		}
 	}
 	if (data->world_mouse_x >= 0 && data->world_mouse_y >= 0) {
@@ -771,14 +966,11 @@ static void HandleSpawnCommand(GameRegion& gameRegion, Human* human) {
 	globalData.pendingSpawnCommand = SpawnCommand{};
 }
 
-void Game::Update() {
-	std::string middleText = "";
-	if (data->consoleActive && data->console) {
-		data->console->Update();
+void Game::SimulationTick(float deltaTime) {
+	for (std::shared_ptr<Placeable>& entity : data->gameRegion.placeables) {
+		entity->prevX = entity->X;
+		entity->prevY = entity->Y;
 	}
-	data->spellSelect->Update();
-	Uint32 nowTime = SDL_GetTicks();
-	Uint32 deltaTime = nowTime - data->lastUpdate;
 	const Uint8* state = SDL_GetKeyboardState(NULL);
 	float deltaX = 0.0f;
 	float deltaY = 0.0f;
@@ -798,8 +990,10 @@ void Game::Update() {
 			}
 		}
 	}
-	data->human->moveX = deltaX;
-	data->human->moveY = deltaY;
+	// Tiles like mud or shallow water slow the player down. See the speed tile property
+	const float tileSpeed = data->gameRegion.world.tile_speed(static_cast<int>(data->human->X)/32, static_cast<int>(data->human->Y)/32);
+	data->human->moveX = deltaX*tileSpeed;
+	data->human->moveY = deltaY*tileSpeed;
 	UpdateHuman(data->human.get(), deltaTime);
 	UpdateDamageNumbers(data->human.get());
 	// Mana regeneration: 5% per second = 1 mana per second
@@ -832,6 +1026,12 @@ void Game::Update() {
 			}
 		}
 		Monster* monster = dynamic_cast<Monster*> (entity.get());
+		if (monster && !UpdatePhysicsLod(*monster, *data->human, data->gameRegion.settings)) {
+			if (monster->health <= 0.0f) {
+				monster->removeMe = true;
+			}
+			monster = nullptr;
+		}
 		if (monster) {
 			UpdateMonster(monster, deltaTime, data->human.get());
 			// Check if monster just attacked
@@ -867,8 +1067,36 @@ void Game::Update() {
 	if (vp.size() != preSize) {
 		std::cout << "Before: " << preSize << ", after: " << vp.size() << "\n";
 	}
-	data->center_x = std::round(data->human->X);
-	data->center_y = std::round(data->human->Y);
+	// The step is scaled down the same way the variable step always was, so the tuning of speeds and impulses still holds
+	data->gameRegion.physicsBox->Step(deltaTime / 1000.0f / 60.0f, velocityIterations, positionIterations);
+}
+
+void Game::Update() {
+	std::string middleText = "";
+	if (data->consoleActive && data->console) {
+		data->console->Update();
+	}
+	data->spellSelect->Update();
+	Uint32 nowTime = SDL_GetTicks();
+	data->tickAccumulator += nowTime - data->lastUpdate;
+	data->lastUpdate = nowTime;
+	int ticks = 0;
+	while (data->tickAccumulator >= simulationTickMs) {
+		if (ticks == maxCatchUpTicks) {
+			// Too far behind. The time is dropped instead of making the next frames even slower
+			data->tickAccumulator = 0.0f;
+			break;
+		}
+		SimulationTick(simulationTickMs);
+		data->tickAccumulator -= simulationTickMs;
+		++ticks;
+	}
+	data->tickAlpha = data->tickAccumulator/simulationTickMs;
+	data->center_x = std::round(RenderX(*data->human, data->tickAlpha));
+	data->center_y = std::round(RenderY(*data->human, data->tickAlpha));
+	// Decode the chunks of infinite maps a bit before they scroll into view
+	const int chunkMargin = 2*sago::tiled::TileChunk::size;
+	data->gameRegion.world.load_chunks_near(data->center_x/32, data->center_y/32, 1280/32/2+chunkMargin, 720/32/2+chunkMargin);
 	int mousex;
 	int mousey;
 	SDL_GetMouseState(&mousex, &mousey);
@@ -878,8 +1106,6 @@ void Game::Update() {
 	data->world_mouse_x = data->topx + logical_mousex;
 	data->world_mouse_y = data->topy + logical_mousey;
 	//std::cout << "world x: " << data->world_mouse_x << ", y: " << data->world_mouse_y << "             \r";
-	data->lastUpdate = nowTime;
-	data->gameRegion.physicsBox->Step(deltaTime / 1000.0f / 60.0f, velocityIterations, positionIterations);
 	std::sort(data->gameRegion.placeables.begin(), data->gameRegion.placeables.end(), sort_placeable);
 	const std::vector<sago::tiled::TileObjectGroup>& object_groups = data->gameRegion.world.tm.object_groups;
 	for (const auto& group : object_groups) {
@@ -887,30 +1113,43 @@ void Game::Update() {
 			if (item.isEllipse) {
 				continue;
 			}
-			if (item.x < data->human->X && item.y < data->human->Y && item.width+item.x > data->human->X
-			        && item.height+item.y > data->human->Y && item.type == "text") {
-				const auto& itr = item.properties.find("text");
-				if (itr != item.properties.end()) {
-					middleText = itr->second.value;
+			if (item.kind == sago::tiled::ObjectType::text && item.x < data->human->X && item.y < data->human->Y
+			        && item.width+item.x > data->human->X && item.height+item.y > data->human->Y) {
+				const std::string* text = group.property(item, "text");
+				if (text) {
+					middleText = *text;
 				}
 			}
 		}
 	}
+	data->gameRegion.UpdateResidentRegions();
+	if (!data->gameRegion.settings.streaming) {
+		PrefetchLikelyRegion(data->gameRegion, *data->human, data->worldName);
+	}
+	// When streaming the player keeps the position along the border, so the map lines up with the neighbor that was drawn.
+	// Otherwise the player enters at the middle of the border
+	const bool seamless = data->gameRegion.settings.streaming;
+	const float borderX = data->human->X/pixel2unit;
+	const float borderY = data->human->Y/pixel2unit;
 	if (data->human->X < 0) {
 		ResetWorld(data->gameRegion.GetRegionX()-1, data->gameRegion.GetRegionY(), false);
-		data->human->body->SetTransform(b2Vec2(data->gameRegion.world.tm.width, data->gameRegion.world.tm.height/2),data->human->body->GetAngle()) ;
+		const float y = seamless ? std::min(borderY, static_cast<float>(data->gameRegion.world.tm.height)) : data->gameRegion.world.tm.height/2;
+		data->human->body->SetTransform(b2Vec2(data->gameRegion.world.tm.width, y),data->human->body->GetAngle()) ;
 	}
 	if (data->human->X > data->gameRegion.world.tm.width*32) {
 		ResetWorld(data->gameRegion.GetRegionX()+1, data->gameRegion.GetRegionY(), false);
-		data->human->body->SetTransform(b2Vec2(0.01f, data->gameRegion.world.tm.height/2),data->human->body->GetAngle()) ;
+		const float y = seamless ? std::min(borderY, static_cast<float>(data->gameRegion.world.tm.height)) : data->gameRegion.world.tm.height/2;
+		data->human->body->SetTransform(b2Vec2(0.01f, y),data->human->body->GetAngle()) ;
 	}
 	if (data->human->Y < 0) {
 		ResetWorld(data->gameRegion.GetRegionX(), data->gameRegion.GetRegionY()-1, false);
-		data->human->body->SetTransform(b2Vec2(data->gameRegion.world.tm.width/2, data->gameRegion.world.tm.height),data->human->body->GetAngle()) ;
+		const float x = seamless ? std::min(borderX, static_cast<float>(data->gameRegion.world.tm.width)) : data->gameRegion.world.tm.width/2;
+		data->human->body->SetTransform(b2Vec2(x, data->gameRegion.world.tm.height),data->human->body->GetAngle()) ;
 	}
 	if (data->human->Y > data->gameRegion.world.tm.height*32) {
 		ResetWorld(data->gameRegion.GetRegionX(), data->gameRegion.GetRegionY()+1, false);
-		data->human->body->SetTransform(b2Vec2(data->gameRegion.world.tm.width/2, 0.01f),data->human->body->GetAngle()) ;
+		const float x = seamless ? std::min(borderX, static_cast<float>(data->gameRegion.world.tm.width)) : data->gameRegion.world.tm.width/2;
+		data->human->body->SetTransform(b2Vec2(x, 0.01f),data->human->body->GetAngle()) ;
 	}
 	if (teleport) {
 		ResetWorld(teleportX, teleportY, false);
@@ -946,11 +1185,21 @@ void Game::Update() {
 				sago::WriteFileContent(dest_filename.c_str(), tsxFile);
 			}
 		}
-		std::string filename = getPathToSaveFiles() + "/" + data->gameRegion.GetFilename();
+		std::string filename = getPathToSaveFiles() + "/" + data->gameRegion.ExportRegionTmx();
 		std::string command = std::string("tiled \"")+filename+"\"";
 		std::system(command.c_str());
+		data->gameRegion.ImportRegionTmx();
 		ResetWorldNoSave(data->gameRegion.GetRegionX(), data->gameRegion.GetRegionY(), false);
 	}
+	if (layerCodecReport) {
+		layerCodecReport = false;
+		std::cout << "Layer codecs for " << data->gameRegion.GetFilename() << " (world uses " << data->gameRegion.settings.layer_codec << ")\n";
+		for (const sago::tiled::LayerCodecStats& stats : sago::tiled::measureLayerCodecs(data->gameRegion.world.tm, data->gameRegion.settings.compression_level)) {
+			double mb = stats.raw_size/1000000.0;
+			std::cout << std::format("{:>8}: {:>9} bytes ({:5.1f}%), write {:8.1f} MB/s, read {:8.1f} MB/s\n", stats.codec, stats.stored_size,
+				100.0*stats.stored_size/std::max<size_t>(stats.raw_size, 1), mb/stats.write_seconds, mb/stats.read_seconds);
+		}
+	}
 	if (reset_region) {
 		ResetWorld(data->gameRegion.GetRegionX(), data->gameRegion.GetRegionY(), true);
 		reset_region = false;
@@ -961,7 +1210,6 @@ void Game::Update() {
 		int tile_x = data->world_mouse_x / 32;
 		int tile_y = data->world_mouse_y / 32;
 		data->gameRegion.CreateLake(data->gameRegion.world, tile_x, tile_y);
-		data->gameRegion.world.init_physics(data->gameRegion.physicsBox);
 		globalData.pendingSpawnLake = false;
 	}
 	if (!globalData.pendingSpawnItem.empty()) {
@@ -988,7 +1236,7 @@ void Game::Update() {
 				data->human->mana -= 5;
 				data->human->castTimeRemaining = data->human->castTime;
 				data->human->animation = "spellcast";
-				std::shared_ptr<Projectile> projectile = std::make_shared<Projectile>();
+				std::shared_ptr<Projectile> projectile = data->gameRegion.arena.make<Projectile>();
 				projectile->X = data->human->X;
 				projectile->Y = data->human->Y;
 				projectile->Radius = 8.0f;
@@ -1023,7 +1271,7 @@ void Game::Update() {
 			if (data->human->castTimeRemaining == 0) {
 				data->human->castTimeRemaining = data->human->castTime;
 				data->human->animation = "spellcast";
-				std::shared_ptr<Projectile> projectile = std::make_shared<Projectile>();
+				std::shared_ptr<Projectile> projectile = data->gameRegion.arena.make<Projectile>();
 				projectile->sprite = "effect_watershot";
 				projectile->X = data->human->X;
 				projectile->Y = data->human->Y;
@@ -1051,7 +1299,7 @@ void Game::Update() {
 				data->human->animation = "slash";
 				// Now do the damage. We are currectly just creating a short lived projectile
 				const auto& target = PairInFrontOfEntity(data->human->X, data->human->Y, data->human->direction);
-				std::shared_ptr<Projectile> projectile = std::make_shared<Projectile>();
+				std::shared_ptr<Projectile> projectile = data->gameRegion.arena.make<Projectile>();
 				projectile->X = target.first;
 				projectile->Y = target.second;
 				projectile->Radius = 8.0f;
@@ -1076,16 +1324,13 @@ void Game::Update() {
 				int tile = data->spell_holder->slot_spell.at(data->spell_holder->slot_selected).tile;
 				int layer_number = data->gameRegion.world.ground2Layer;
 				if (layer_number >= 0) {
-					for (int dy = 0; dy < data->brushSize; ++dy) {
-						for (int dx = 0; dx < data->brushSize; ++dx) {
-							int tile_x = base_tile_x + dx;
-							int tile_y = base_tile_y + dy;
-							if (sago::tiled::tileInBound(data->gameRegion.world.tm, tile_x, tile_y)
-							        && !(data->gameRegion.world.tile_protected(tile_x, tile_y)) ) {
-								sago::tiled::setTileOnLayerNumber(data->gameRegion.world.tm, layer_number, tile_x, tile_y, tile);
-								data->gameRegion.liqudHandler["ground"].updateFirstTile(data->gameRegion.world.tm, tile_x, tile_y);
-							}
-						}
+					std::vector<std::pair<int, int>> changed = PaintBrush(data->gameRegion.world, layer_number, base_tile_x, base_tile_y, data->brushSize, tile);
+					for (const auto& [tile_x, tile_y] : changed) {
+						data->gameRegion.liqudHandler["ground"].updateFirstTile(data->gameRegion.world.tm, tile_x, tile_y);
+					}
+					// The ground tiles may have the blocking property
+					if (changed.size()) {
+						data->gameRegion.world.update_tiles(base_tile_x, base_tile_y, data->brushSize, data->brushSize);
 					}
 				}
 			}
@@ -1098,22 +1343,13 @@ void Game::Update() {
 				int base_tile_y = data->world_mouse_y/32;
 				int tile = data->spell_holder->slot_spell.at(data->spell_holder->slot_selected).tile;
 				int layer_number = data->gameRegion.world.blockingLayer;
-				bool anyTileChanged = false;
-				for (int dy = 0; dy < data->brushSize; ++dy) {
-					for (int dx = 0; dx < data->brushSize; ++dx) {
-						int tile_x = base_tile_x + dx;
-						int tile_y = base_tile_y + dy;
-						if (sago::tiled::tileInBound(data->gameRegion.world.tm, tile_x, tile_y)
-						        && !(data->gameRegion.world.tile_protected(tile_x, tile_y)) ) {
-							sago::tiled::setTileOnLayerNumber(data->gameRegion.world.tm, layer_number, tile_x, tile_y, tile);
-							data->gameRegion.liqudHandler["water"].updateFirstTile(data->gameRegion.world.tm, tile_x, tile_y);
-							data->gameRegion.liqudHandler["lava"].updateFirstTile(data->gameRegion.world.tm, tile_x, tile_y);
-							anyTileChanged = true;
-						}
-					}
+				std::vector<std::pair<int, int>> changed = PaintBrush(data->gameRegion.world, layer_number, base_tile_x, base_tile_y, data->brushSize, tile);
+				for (const auto& [tile_x, tile_y] : changed) {
+					data->gameRegion.liqudHandler["water"].updateFirstTile(data->gameRegion.world.tm, tile_x, tile_y);
+					data->gameRegion.liqudHandler["lava"].updateFirstTile(data->gameRegion.world.tm, tile_x, tile_y);
 				}
-				if (anyTileChanged) {
-					data->gameRegion.world.init_physics(data->gameRegion.physicsBox);
+				if (changed.size()) {
+					data->gameRegion.world.update_tiles(base_tile_x, base_tile_y, data->brushSize, data->brushSize);
 				}
 			}
 		}
@@ -1125,22 +1361,13 @@ void Game::Update() {
 				int base_tile_y = data->world_mouse_y/32;
 				int layer_number = data->gameRegion.world.blockingLayer;
 				uint32_t tile = 0;
-				bool anyTileChanged = false;
-				for (int dy = 0; dy < data->brushSize; ++dy) {
-					for (int dx = 0; dx < data->brushSize; ++dx) {
-						int tile_x = base_tile_x + dx;
-						int tile_y = base_tile_y + dy;
-						if (sago::tiled::tileInBound(data->gameRegion.world.tm, tile_x, tile_y)
-						        && !(data->gameRegion.world.tile_protected(tile_x, tile_y)) ) {
-							sago::tiled::setTileOnLayerNumber(data->gameRegion.world.tm, layer_number, tile_x, tile_y, tile);
-							data->gameRegion.liqudHandler["water"].updateFirstTile(data->gameRegion.world.tm, tile_x, tile_y);
-							data->gameRegion.liqudHandler["lava"].updateFirstTile(data->gameRegion.world.tm, tile_x, tile_y);
-							anyTileChanged = true;
-						}
-					}
+				std::vector<std::pair<int, int>> changed = PaintBrush(data->gameRegion.world, layer_number, base_tile_x, base_tile_y, data->brushSize, tile);
+				for (const auto& [tile_x, tile_y] : changed) {
+					data->gameRegion.liqudHandler["water"].updateFirstTile(data->gameRegion.world.tm, tile_x, tile_y);
+					data->gameRegion.liqudHandler["lava"].updateFirstTile(data->gameRegion.world.tm, tile_x, tile_y);
 				}
-				if (anyTileChanged) {
-					data->gameRegion.world.init_physics(data->gameRegion.physicsBox);
+				if (changed.size()) {
+					data->gameRegion.world.update_tiles(base_tile_x, base_tile_y, data->brushSize, data->brushSize);
 				}
 			}
 		}
@@ -42,6 +42,11 @@ private:
 	void ResetWorld(int region_x, int region_y, bool forceResetWorld);
 	void ResetWorldNoSave(int region_x, int region_y, bool forceResetWorld);
 	void RespawnPlayer();
+	/**
+	 * Advances the creatures, projectiles and physics by one fixed step
+	 * @param deltaTime The length of the step in milliseconds
+	 */
+	void SimulationTick(float deltaTime);
 	/**
 	 * @brief Respawns the player or any other dead action.
 	 *
@@ -24,6 +24,7 @@ https://github.com/sago007/saland
 #include "GameDraw.hpp"
 #include "GameHair.hpp"
 #include <SDL2/SDL2_gfxPrimitives.h>
+#include <algorithm>
 #include <cmath>
 #include "../sago/SagoTextField.hpp"
 
@@ -82,38 +83,42 @@ static void DrawCollision(SDL_Renderer* target, const Placeable* entity, int off
 	}
 }
 
-void DrawOuterBorder(SDL_Renderer* renderer, SDL_Texture* texture, const sago::tiled::TileMap& tm, int topx, int topy, uint32 outerTile, sago::SagoLogicalResize* resize) {
-	for (int i = -1; i < tm.width + 1; ++i) {
+void DrawOuterBorder(SDL_Renderer* renderer, const GidAtlas& atlas, const sago::tiled::TileMap& tm, int topx, int topy, uint32 outerTile, sago::SagoLogicalResize* resize) {
+	const GidAtlasEntry* tile = atlas.Get(outerTile);
+	if (!tile) {
+		return;
+	}
+	// Only the part of the border that is in view. The border of a large map is long
+	const int viewWidth = 1280;
+	const int viewHeight = 720;
+	const int firstX = std::max(-1, topx/32-1);
+	const int lastX = std::min(tm.width + 1, (topx+viewWidth)/32+1);
+	const int firstY = std::max(0, topy/32-1);
+	const int lastY = std::min(tm.height, (topy+viewHeight)/32+1);
+	for (int i = firstX; i < lastX; ++i) {
 		if (i >= tm.width/2-5 && i < tm.width/2+5) {
 			continue;
 		}
-		SDL_Rect part{};
-		getTextureLocationFromGid(tm, outerTile, nullptr, &part.x, &part.y, &part.w, &part.h);
-		Draw(renderer, texture, 32 * i - topx, -32 - topy, part, resize);
-		Draw(renderer, texture, 32 * i - topx, 32 * tm.height - topy, part, resize);
+		Draw(renderer, tile->texture, 32 * i - topx, -32 - topy, tile->part, resize);
+		Draw(renderer, tile->texture, 32 * i - topx, 32 * tm.height - topy, tile->part, resize);
 	}
-	for (int i = 0; i < tm.height; ++i) {
+	for (int i = firstY; i < lastY; ++i) {
 		if (i >= tm.height/2-5 && i < tm.height/2+5) {
 			continue;
 		}
-		SDL_Rect part{};
-		getTextureLocationFromGid(tm, outerTile, nullptr, &part.x, &part.y, &part.w, &part.h);
-		Draw(renderer, texture, 32 * tm.width - topx, 32*i - topy, part, resize);
-		Draw(renderer, texture, -32 - topx, 32*i - topy, part, resize);
+		Draw(renderer, tile->texture, 32 * tm.width - topx, 32*i - topy, tile->part, resize);
+		Draw(renderer, tile->texture, -32 - topx, 32*i - topy, tile->part, resize);
 	}
 }
 
-void DrawTile(SDL_Renderer* renderer, sago::SagoSpriteHolder* sHolder, const sago::tiled::TileMap& tm, uint32_t gid, int x, int y, sago::SagoLogicalResize* resize) {
-	SDL_Rect part{};
-	std::string imageFile;
-	getTextureLocationFromGid(tm, gid, &imageFile, &part.x, &part.y, &part.w, &part.h);
-	imageFile = imageFile.substr(12);
-	imageFile = imageFile.substr(0, imageFile.length()-4);
-	SDL_Texture* texture = sHolder->GetDataHolder().getTexturePtr(imageFile);
-	Draw(renderer, texture, x, y, part, resize);
+void DrawTile(SDL_Renderer* renderer, const GidAtlas& atlas, uint32_t gid, int x, int y, sago::SagoLogicalResize* resize) {
+	const GidAtlasEntry* tile = atlas.Get(gid);
+	if (tile) {
+		Draw(renderer, tile->texture, x, y, tile->part, resize);
+	}
 }
 
-void DrawLayer(SDL_Renderer* renderer, sago::SagoSpriteHolder* sHolder, const sago::tiled::TileMap& tm, size_t layer, int topx, int topy, sago::SagoLogicalResize* resize) {
+void DrawLayer(SDL_Renderer* renderer, const GidAtlas& atlas, const sago::tiled::TileMap& tm, size_t layer, int topx, int topy, sago::SagoLogicalResize* resize) {
 	int startX = topx/32;
 	int startY = topy/32;
 	if (startX < 0) {
@@ -125,20 +130,20 @@ void DrawLayer(SDL_Renderer* renderer, sago::SagoSpriteHolder* sHolder, const sa
 	// Use logical size for drawing range
 	int viewWidth = 1280;
 	int viewHeight = 720;
-	for (int i = startX; i < tm.width && i < (topx+viewWidth)/32+1; ++i) {
-		for (int j = startY; j < tm.height && j < (topy+viewHeight)/32+1; ++j) {
-			uint32_t gid = sago::tiled::getTileFromLayer(tm, tm.layers.at(layer), i, j);
-			if (gid == 0) {
-				continue;
-			}
-			DrawTile(renderer, sHolder, tm, gid, 32 * i - topx, 32 * j - topy, resize);
+	int endX = (topx+viewWidth)/32+1;
+	int endY = (topy+viewHeight)/32+1;
+	//Empty chunks of the layer are skipped entirely
+	tm.layers.at(layer).data.tiles.forEachNonZero(startX, startY, endX-startX, endY-startY, [&](int i, int j, uint32_t gid) {
+		const GidAtlasEntry* tile = atlas.Get(gid);
+		if (tile) {
+			Draw(renderer, tile->texture, 32 * i - topx, 32 * j - topy, tile->part, resize);
 		}
-	}
+	});
 }
 
 void DrawOjbectGroup(SDL_Renderer* renderer, const sago::tiled::TileMap& tm, size_t object_group, int topx, int topy, sago::SagoLogicalResize* resize) {
 	const sago::tiled::TileObjectGroup& group = tm.object_groups.at(object_group);
-	for (const sago::tiled::TileObject& o : group.objects) {
+	for (const sago::tiled::ObjectRecord& o : group.objects) {
 		if (o.isEllipse) {
 			int cx = (o.x + o.width / 2) - topx;
 			int cy = (o.y + o.height / 2) - topy;
@@ -153,10 +158,11 @@ void DrawOjbectGroup(SDL_Renderer* renderer, const sago::tiled::TileMap& tm, siz
 			}
 			ellipseRGBA(renderer, cx, cy, rx, ry, 255, 255, 0, 255);
 		}
-		else if (o.polygon_points.size() > 0) {
-			for (size_t i = 0; i < o.polygon_points.size(); ++i) {
-				std::pair<int, int> first = o.polygon_points.at(i);
-				std::pair<int, int> second = (i + 1 < o.polygon_points.size()) ? o.polygon_points.at(i + 1) : o.polygon_points.at(0);
+		else if (o.pointCount > 0) {
+			const std::span<const std::pair<int, int> > polygon_points = group.points(o);
+			for (size_t i = 0; i < polygon_points.size(); ++i) {
+				std::pair<int, int> first = polygon_points[i];
+				std::pair<int, int> second = (i + 1 < polygon_points.size()) ? polygon_points[i + 1] : polygon_points[0];
 				int x1 = first.first + o.x - topx;
 				int y1 = first.second + o.y - topy;
 				int x2 = second.first + o.x - topx;
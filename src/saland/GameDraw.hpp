@@ -27,10 +27,11 @@ https://github.com/sago007/saland
 #include "globals.hpp"
 #include "model/placeables.hpp"
 #include "model/World.hpp"
+#include "GidAtlas.hpp"
 #include "SDL.h"
 
-void DrawOuterBorder(SDL_Renderer* renderer, SDL_Texture* texture, const sago::tiled::TileMap& tm, int topx, int topy, uint32 outerTile, sago::SagoLogicalResize* resize = nullptr);
-void DrawLayer(SDL_Renderer* renderer, sago::SagoSpriteHolder* sHolder, const sago::tiled::TileMap& tm, size_t layer, int topx, int topy, sago::SagoLogicalResize* resize = nullptr);
+void DrawOuterBorder(SDL_Renderer* renderer, const GidAtlas& atlas, const sago::tiled::TileMap& tm, int topx, int topy, uint32 outerTile, sago::SagoLogicalResize* resize = nullptr);
+void DrawLayer(SDL_Renderer* renderer, const GidAtlas& atlas, const sago::tiled::TileMap& tm, size_t layer, int topx, int topy, sago::SagoLogicalResize* resize = nullptr);
 void DrawOjbectGroup(SDL_Renderer* renderer, const sago::tiled::TileMap& tm, size_t object_group, int topx, int topy, sago::SagoLogicalResize* resize = nullptr);
 void DrawMiscEntity(SDL_Renderer* target, sago::SagoSpriteHolder* sHolder, const MiscItem* entity, float time,
                     int offsetX, int offsetY, bool drawCollision, sago::SagoLogicalResize* resize = nullptr);
@@ -40,7 +41,7 @@ void DrawProjectile(SDL_Renderer* target, sago::SagoSpriteHolder* sHolder, const
 
 void DrawRectWhite(SDL_Renderer* target, int topx, int topy, int height, int width, sago::SagoLogicalResize* resize = nullptr);
 void DrawRectYellow(SDL_Renderer* target, int topx, int topy, int height, int width, sago::SagoLogicalResize* resize = nullptr);
-void DrawTile(SDL_Renderer* renderer, sago::SagoSpriteHolder* sHolder, const sago::tiled::TileMap& tm, uint32_t gid, int x, int y, sago::SagoLogicalResize* resize = nullptr);
+void DrawTile(SDL_Renderer* renderer, const GidAtlas& atlas, uint32_t gid, int x, int y, sago::SagoLogicalResize* resize = nullptr);
 void DrawDamageNumbers(SDL_Renderer* target, Placeable* entity, int offsetX, int offsetY, sago::SagoLogicalResize* resize = nullptr);
 void UpdateDamageNumbers(Placeable* entity);
 
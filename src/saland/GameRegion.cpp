@@ -24,22 +24,33 @@ https://github.com/sago007/saland
 #include "GameRegion.hpp"
 #include "GameItems.hpp"
 #include "GameMonsters.hpp"
+#include "../sagotmx/tmx_binary.h"
+#include "../sagotmx/tmx_delta.h"
+#include "TiledAssetCache.hpp"
+#include "SaveQueue.hpp"
+#include "../terrain/RegionGenerator.hpp"
+#include <array>
 #include <cmath>
 #include <random>
+#include <stdexcept>
 
 GameRegion::GameRegion() {
 	Init(0, 0, "world1", false);
 }
 
-static std::string createFileName(int x, int y,const std::string& worldName) {
-	std::string ret = std::string("worlds/")+worldName+"/"+std::string("maps/m")+std::to_string(x)+"x"+std::to_string(y)+".tmx" ;
+/**
+ * The filename of a region inside a world.
+ * Regions are saved as ".region" (binary). ".tmx" is used for the old save format and for editing in Tiled.
+ */
+static std::string createFileName(int x, int y,const std::string& worldName, const char* extension) {
+	std::string ret = std::string("worlds/")+worldName+"/"+std::string("maps/m")+std::to_string(x)+"x"+std::to_string(y)+extension;
 	return ret;
 }
 
 
 
 void GameRegion::SpawnMonster(const MonsterDef& def, float destX, float destY) {
-	std::shared_ptr<Monster> monster = std::make_shared<Monster>();
+	std::shared_ptr<Monster> monster = arena.make<Monster>();
 	monster.get()->Radius = def.radius;
 	monster.get()->race = def.race;
 	monster.get()->X = destX;
@@ -88,11 +99,11 @@ void GameRegion::SpawnPrefab(const Prefab& prefab, int destX, int destY) {
 		}
 	}
 	ApplyPrefab(world.tm, destX, destY, prefab);
-	this->world.init_physics(this->physicsBox);
+	this->world.update_tiles(destX, destY, prefab.width, prefab.height);
 }
 
 void GameRegion::SpawnItem(const ItemDef& def, float destX, float destY) {
-	std::shared_ptr<MiscItem> barrel = std::make_shared<MiscItem>();
+	std::shared_ptr<MiscItem> barrel = arena.make<MiscItem>();
 	barrel.get()->Radius = def.radius;
 	barrel.get()->sprite = def.sprite;
 	barrel.get()->sprite2 = def.sprite2;
@@ -159,15 +170,15 @@ const int LAKE_HEIGHT = 10; // height of the lake pattern
 const int LAKE_SIZE = 40; // maximum size of the lake
 const int LAKE_MIN_SIZE = 8;
 
+typedef std::array<std::array<int, LAKE_HEIGHT>, LAKE_WIDTH> LakePattern;
+
 /**
  * function to generate a random lake pattern
  */
-static std::vector<std::vector<int>> generateLakePattern() {
-	std::vector<std::vector<int>> pattern(LAKE_WIDTH, std::vector<int>(LAKE_HEIGHT, 0));
+static LakePattern generateLakePattern(std::mt19937& gen) {
+	LakePattern pattern{};
 
 	// choose a random point in the pattern as the center of the lake
-	std::random_device rd;
-	std::mt19937 gen(rd());
 	std::uniform_int_distribution<int> dist_x(0, LAKE_WIDTH - 1);
 	std::uniform_int_distribution<int> dist_y(0, LAKE_HEIGHT - 1);
 	int center_x = LAKE_WIDTH/2;
@@ -251,16 +262,24 @@ void GameRegion::ProcessRegionFirstTimeEnter(World& world) {
 
 void GameRegion::CreateLake(World& world)
 {
-    // Add a small lake
-    int x = (rand() % (world.tm.width - LAKE_WIDTH));
-    int y = (rand() % (world.tm.height - LAKE_HEIGHT));
-    CreateLake(world, x, y);
+    // Add a small lake. Always the same one for the same region of a world
+    std::mt19937 gen(RegionSeed(settings.seed, region_x, region_y));
+    int x = std::uniform_int_distribution<int>(0, world.tm.width - LAKE_WIDTH - 1)(gen);
+    int y = std::uniform_int_distribution<int>(0, world.tm.height - LAKE_HEIGHT - 1)(gen);
+    CreateLake(world, x, y, gen);
 }
 
 void GameRegion::CreateLake(World& world, int tile_x, int tile_y)
+{
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    CreateLake(world, tile_x, tile_y, gen);
+}
+
+void GameRegion::CreateLake(World& world, int tile_x, int tile_y, std::mt19937& gen)
 {
     // Add a small lake at specified location
-    const auto &pattern = generateLakePattern();
+    const LakePattern pattern = generateLakePattern(gen);
     for (size_t i = 0; i < LAKE_WIDTH; ++i)
     {
         for (size_t j = 0; j < LAKE_HEIGHT; ++j)
@@ -275,6 +294,7 @@ void GameRegion::CreateLake(World& world, int tile_x, int tile_y)
             liqudHandler["water"].updateFirstTile(world.tm, tile_x + i, tile_y + j);
         }
     }
+    world.update_tiles(tile_x, tile_y, LAKE_WIDTH, LAKE_HEIGHT);
 }
 
 void GameRegion::ProcessRegionEnter(World& world) {
@@ -291,6 +311,13 @@ void GameRegion::ProcessRegionEnter(World& world) {
 }
 
 
+/**
+ * Regions that are always made from their own hand made map
+ */
+static bool RegionIsHandMade(int region_x, int region_y) {
+	return (region_x == 0 && region_y == 0) || (region_x == 0 && region_y == -2) || (region_x == 3 && region_y == 3);
+}
+
 static std::string RegionChooseMapTemplate(int region_x, int region_y) {
 	std::string loadMap = "maps/desert.tmx";
 	if (GetRegionType(region_x, region_y) == "forrest") {
@@ -310,51 +337,268 @@ static std::string RegionChooseMapTemplate(int region_x, int region_y) {
 
 void GameRegion::InitCommon() {
 	placeables.clear();
+	// Box2D keeps the bodies and fixtures in the block allocator of the b2World, so they go in one piece with the world
 	physicsBox.reset(new b2World(b2Vec2(0.0f, 0.0f)));
 	world.managed_bodies.clear();
+	arena.reset();
+}
 
-	liqudHandler["water"].blockingLayer = world.blockingLayer;
-	liqudHandler["water"].blockingLayer_overlay_1 = world.blockingLayer_overlay_1;
-	liqudHandler["water"].setupTiles(28);
-	liqudHandler["lava"].blockingLayer = world.blockingLayer;
-	liqudHandler["lava"].blockingLayer_overlay_1 = world.blockingLayer_overlay_1;
-	liqudHandler["lava"].setupTiles(16);
-	liqudHandler["ground"].blockingLayer = world.ground2Layer;
-	liqudHandler["ground"].blockingLayer_overlay_1 = world.ground2OverlayLayer;
-	liqudHandler["ground"].setupTiles(1);
+/**
+ * Sets up a handler with the tiles of an autotile of the tileset. The handler is turned off if the map has no such tiles
+ */
+static void SetupAutotileHandler(WaterHandler& handler, const sago::tiled::TileAttributeTable& attributes, const std::string& name, int layer, int overlayLayer) {
+	const uint32_t first_tile = attributes.autotileGid(name);
+	if (!first_tile) {
+		handler.blockingLayer = -1;
+		handler.blockingLayer_overlay_1 = -1;
+		return;
+	}
+	handler.blockingLayer = layer;
+	handler.blockingLayer_overlay_1 = overlayLayer;
+	handler.setupTiles(first_tile);
+	handler.setupAttributes(attributes, name);
+}
 
+void GameRegion::InitLiquidHandlers() {
+	SetupAutotileHandler(liqudHandler["water"], world.tileAttributes, "water", world.blockingLayer, world.blockingLayer_overlay_1);
+	SetupAutotileHandler(liqudHandler["lava"], world.tileAttributes, "lava", world.blockingLayer, world.blockingLayer_overlay_1);
+	SetupAutotileHandler(liqudHandler["ground"], world.tileAttributes, "ground", world.ground2Layer, world.ground2OverlayLayer);
 }
 
 void GameRegion::InitDungeon(const std::string& dungeonName, const std::string& dungeonType, bool forceResetWorld) {
+	FinishQueuedSaves();
 	InitCommon();
+	worldName.clear();
 	world.init(physicsBox, "maps/"+dungeonName+".tmx");
+	InitLiquidHandlers();
 }
 
 
-void GameRegion::Init(int x, int y, const std::string& worldName, bool forceResetWorld) {
-	bool newRegion = false;  //If this is a new region to be generated
-	region_x = x;
-	region_y = y;
-	mapFileName = createFileName(region_x, region_y, worldName);
+/**
+ * Reads a region and prepares it. Only touches files of the region, so it can be done on another thread.
+ */
+static LoadedRegion LoadRegion(int x, int y, const std::string& worldName, bool forceResetWorld) {
+	LoadedRegion ret;
+	ret.x = x;
+	ret.y = y;
+	ret.worldName = worldName;
+	const std::string mapFileName = createFileName(x, y, worldName, ".region");
+	const std::string tmxFileName = createFileName(x, y, worldName, ".tmx");
+	const std::string journalFileName = createFileName(x, y, worldName, ".journal");
+	// A save of the region might still be in progress
+	WaitForQueuedFile(mapFileName);
+	WaitForQueuedFile(journalFileName);
+	ret.settings = LoadWorldSettings(worldName);
 	std::string loadMap = mapFileName;
+	if (!sago::FileExists(loadMap.c_str())) {
+		// Saved before the binary format. Will be converted on next save.
+		loadMap = tmxFileName;
+	}
+	bool generate = false;
 	if (!sago::FileExists(loadMap.c_str()) || forceResetWorld) {
-		loadMap = RegionChooseMapTemplate(region_x, region_y);
-		newRegion = true;
+		loadMap = RegionChooseMapTemplate(x, y);
+		ret.newRegion = true;
+		generate = ret.settings.procedural_regions && !RegionIsHandMade(x, y);
+		if (generate) {
+			// The template only provides the tilesets and layers. It must have the size of the regions
+			const sago::tiled::TileMap& forrest = *GetCachedTileMap("maps/template_forrest.tmx");
+			const bool desert = GetGeneratedBiome(ret.settings.seed, x, y, forrest.width, forrest.height) == "desert";
+			loadMap = desert ? "maps/desert.tmx" : "maps/template_forrest.tmx";
+		}
+	}
+	try {
+		ret.world.load(loadMap);
+	}
+	catch (std::exception& e) {
+		throw std::runtime_error("Cannot load region "+std::to_string(x)+","+std::to_string(y)+" of world \""+worldName+"\" from "+loadMap+": "+e.what());
+	}
+	// A new or reset region must be written in full on the first flush. Its journal would not match the map on disk
+	ret.regionSaved = !ret.newRegion && loadMap == mapFileName;
+	if (ret.newRegion) {
+		if (generate) {
+			RegionGeneratorLayers layers;
+			layers.ground2Layer = ret.world.ground2Layer;
+			layers.ground2OverlayLayer = ret.world.ground2OverlayLayer;
+			layers.blockingLayer = ret.world.blockingLayer;
+			layers.blockingLayer_overlay_1 = ret.world.blockingLayer_overlay_1;
+			GenerateRegion(ret.world.tm, layers, ret.world.tileAttributes, ret.settings.seed, x, y);
+			ret.world.update_tiles(0, 0, ret.world.tm.width, ret.world.tm.height);
+		}
+		// Lets SaveRegion store only the changes to the template
+		sago::tiled::setMapProperty(ret.world.tm, "template", loadMap);
+		sago::tiled::setMapProperty(ret.world.tm, "template_hash", GetCachedTileMapWithHash(loadMap).contentHash);
+		if (sago::FileExists(journalFileName.c_str())) {
+			sago::RemoveFile(journalFileName.c_str());
+		}
+	}
+	else if (loadMap == mapFileName) {
+		std::string journalContent = sago::GetFileContent(journalFileName);
+		ret.journalBytes = journalContent.size();
+		if (journalContent.length()) {
+			sago::tiled::applyTilemapJournal(ret.world.tm, journalContent, sago::tiled::getMapProperty(ret.world.tm, "journal_base"));
+		}
+	}
+	return ret;
+}
+
+/**
+ * LoadRegion for the background threads. The layers are decoded serially so the game never waits for the pool behind them
+ */
+static LoadedRegion LoadRegionInBackground(int x, int y, const std::string& worldName) {
+	sago::tiled::LayerWorkers::SerialScope serial;
+	return LoadRegion(x, y, worldName, false);
+}
+
+void GameRegion::PrefetchRegion(int x, int y, const std::string& worldName) {
+	if (prefetch.valid() && prefetchX == x && prefetchY == y && prefetchWorldName == worldName) {
+		return;
+	}
+	if (prefetch.valid() && prefetch.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+		// Replacing a load that is not done would wait for it
+		return;
+	}
+	prefetchX = x;
+	prefetchY = y;
+	prefetchWorldName = worldName;
+	prefetch = std::async(std::launch::async, LoadRegionInBackground, x, y, worldName);
+}
+
+/**
+ * Waits for a region being loaded in the background.
+ * @return true if loaded was set
+ */
+static bool TakeLoadingRegion(std::future<LoadedRegion>& loading, LoadedRegion& loaded) {
+	try {
+		loaded = loading.get();
+		return true;
+	}
+	catch (std::exception& e) {
+		std::cerr << "Failed to load region in the background: " << e.what() << "\n";
+	}
+	return false;
+}
+
+void GameRegion::UpdateResidentRegions() {
+	for (auto itr = residentLoading.begin(); itr != residentLoading.end(); ) {
+		if (itr->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++itr;
+			continue;
+		}
+		LoadedRegion loaded;
+		if (TakeLoadingRegion(itr->second, loaded) && loaded.worldName == worldName) {
+			residentRegions[itr->first] = std::move(loaded);
+		}
+		itr = residentLoading.erase(itr);
+	}
+	// Evicted regions have been flushed when they were left, so they can simply be forgotten
+	for (auto itr = residentRegions.begin(); itr != residentRegions.end(); ) {
+		const bool neighbor = std::abs(itr->first.first-region_x) <= 1 && std::abs(itr->first.second-region_y) <= 1;
+		if (!neighbor || itr->second.worldName != worldName || !settings.streaming) {
+			itr = residentRegions.erase(itr);
+		}
+		else {
+			++itr;
+		}
+	}
+	if (!settings.streaming) {
+		return;
+	}
+	for (int dy = -1; dy <= 1; ++dy) {
+		for (int dx = -1; dx <= 1; ++dx) {
+			const std::pair<int, int> key(region_x+dx, region_y+dy);
+			if ((dx == 0 && dy == 0) || residentRegions.count(key) || residentLoading.count(key)) {
+				continue;
+			}
+			residentLoading[key] = std::async(std::launch::async, LoadRegionInBackground, key.first, key.second, worldName);
+		}
+	}
+}
+
+const World* GameRegion::GetResidentRegion(int dx, int dy) const {
+	const auto itr = residentRegions.find(std::make_pair(region_x+dx, region_y+dy));
+	if (itr == residentRegions.end() || itr->second.newRegion) {
+		return nullptr;
 	}
+	return &itr->second.world;
+}
 
+void GameRegion::Init(int x, int y, const std::string& worldName, bool forceResetWorld) {
+	FinishQueuedSaves();
+	if (settings.streaming && this->worldName.length() && (x != region_x || y != region_y || worldName != this->worldName)) {
+		// The region being left has just been flushed, so it can stay resident as it is
+		LoadedRegion& left = residentRegions[std::make_pair(region_x, region_y)];
+		left.x = region_x;
+		left.y = region_y;
+		left.worldName = this->worldName;
+		left.newRegion = false;
+		left.settings = settings;
+		left.world = std::move(world);
+		left.world.detach_physics();
+		left.regionSaved = regionSaved;
+		left.journalBytes = journalBytes;
+	}
+	LoadedRegion loaded;
+	bool prefetched = false;
+	const std::pair<int, int> key(x, y);
+	const auto resident = residentRegions.find(key);
+	if (resident != residentRegions.end()) {
+		// Taken even if it is not used, as it will be outdated once the region has been entered
+		if (resident->second.worldName == worldName && !forceResetWorld) {
+			loaded = std::move(resident->second);
+			prefetched = true;
+		}
+		residentRegions.erase(resident);
+	}
+	const auto loading = residentLoading.find(key);
+	if (loading != residentLoading.end()) {
+		LoadedRegion fromLoading;
+		if (TakeLoadingRegion(loading->second, fromLoading) && !prefetched && fromLoading.worldName == worldName && !forceResetWorld) {
+			loaded = std::move(fromLoading);
+			prefetched = true;
+		}
+		residentLoading.erase(loading);
+	}
+	if (prefetch.valid() && prefetchX == x && prefetchY == y && prefetchWorldName == worldName) {
+		LoadedRegion fromPrefetch;
+		if (TakeLoadingRegion(prefetch, fromPrefetch) && !prefetched && !forceResetWorld) {
+			loaded = std::move(fromPrefetch);
+			prefetched = true;
+		}
+	}
+	if (!prefetched) {
+		loaded = LoadRegion(x, y, worldName, forceResetWorld);
+	}
+	const bool newRegion = loaded.newRegion;  //If this is a new region to be generated
+	region_x = x;
+	region_y = y;
+	this->worldName = worldName;
+	mapFileName = createFileName(region_x, region_y, worldName, ".region");
+	tmxFileName = createFileName(region_x, region_y, worldName, ".tmx");
+	journalFileName = createFileName(region_x, region_y, worldName, ".journal");
+	regionSaved = loaded.regionSaved;
+	journalBytes = loaded.journalBytes;
+	settings = loaded.settings;
 	InitCommon();
 	ScanPrefabs("prefabs01");
-	world.init(physicsBox, loadMap);
+	world = std::move(loaded.world);
+	world.attach_physics(physicsBox);
+	if (world.blockingLayer >= 0) {
+		const size_t blockingTiles = world.tm.layers.at(world.blockingLayer).data.tiles.countNonZero();
+		std::cout << "Region " << x << "," << y << ": " << world.count_fixtures() << " static fixtures, blocking layer "
+			<< blockingTiles << " tiles merged into " << world.count_blocking_fixtures() << " fixtures\n";
+	}
+	InitLiquidHandlers();
+	journal.track(world.tm);
 
 
 	const std::vector<sago::tiled::TileObjectGroup>& object_groups = world.tm.object_groups;
 	for (const auto& group : object_groups) {
 		for (const auto& item : group.objects) {
-			if (item.type == "itemSpawn") {
+			if (item.kind == sago::tiled::ObjectType::itemSpawn) {
 				std::string itemname;
-				const auto& itr = item.properties.find("itemname");
-				if (itr != item.properties.end()) {
-					itemname = itr->second.value;
+				const std::string* value = group.property(item, "itemname");
+				if (value) {
+					itemname = *value;
 				}
 				if (itemname[0]) {
 					ItemDef itemDef = getItem(itemname);
@@ -379,8 +623,9 @@ void GameRegion::Init(int x, int y, const std::string& worldName, bool forceRese
 
 
 	//Forrest region
+	// Generated regions already have the type of their biome
 	std::string regionType = GetRegionType(region_x, region_y);
-	if (regionType == "forrest" || regionType == "start" ) {
+	if (world.tm.properties["type"].value.empty() && (regionType == "forrest" || regionType == "start")) {
 		world.tm.properties["type"].value = "forrest";
 	}
 	if (newRegion) {
@@ -397,7 +642,30 @@ void GameRegion::Init(int x, int y, const std::string& worldName, bool forceRese
 	SpawnMonster(beeDef, 220.0f, 220.0f);
 }
 
-void GameRegion::SaveRegion() {
+/**
+ * Returns the map as it should be saved. Called on the save thread.
+ * Regions generated from a template are stored as the changes to the template. If the template has changed since the region
+ * was generated the full map is stored, as the unchanged tiles would otherwise follow the new template.
+ */
+static sago::tiled::TileMap GetStoredRegion(const sago::tiled::TileMap& tm) {
+	const std::string templateName = sago::tiled::getMapProperty(tm, "template");
+	if (templateName.empty()) {
+		return tm;
+	}
+	try {
+		const CachedTileMap base = GetCachedTileMapWithHash(templateName);
+		sago::tiled::TileMap delta = sago::tiled::makeTilemapDelta(*base.map, tm, templateName, base.contentHash);
+		if (sago::tiled::getMapProperty(delta, sago::tiled::delta_hash_property) == sago::tiled::getMapProperty(tm, "template_hash")) {
+			return delta;
+		}
+	}
+	catch (std::exception& e) {
+		std::cerr << "Failed to use template " << templateName << ": " << e.what() << "\n";
+	}
+	return tm;
+}
+
+void GameRegion::UpdateMutableObjects() {
 	sago::tiled::TileObjectGroup tog;
 	tog.name = "mutableObjects";
 	for (const std::shared_ptr<Placeable>& p : placeables) {
@@ -412,7 +680,7 @@ void GameRegion::SaveRegion() {
 				to.x = m->X;
 				to.y = m->Y;
 				to.id = tog.objects.size()+1000;
-				tog.objects.push_back(to);
+				tog.add(to);
 			}
 		}
 	}
@@ -429,7 +697,117 @@ void GameRegion::SaveRegion() {
 	else {
 		world.tm.object_groups.at(mutableLayer) = tog;
 	}
-	std::string data2save = sago::tiled::tilemap2string(world.tm);
-	sago::WriteFileContent(mapFileName.c_str(), data2save);
+}
+
+void GameRegion::SaveRegion() {
+	UpdateMutableObjects();
+	ApplyLayerCodec();
+	// A new id makes the journal of the previous save obsolete, even if it cannot be removed
+	const std::string journalBase = sago::tiled::getMapProperty(world.tm, "journal_base");
+	sago::tiled::setMapProperty(world.tm, "journal_base", std::to_string(sago::StrToLong(journalBase.c_str())+1));
+	// The snapshot shares the tiles with the world until the world changes them, so the game can go on while it is written
+	std::shared_ptr<const sago::tiled::TileMap> snapshot = std::make_shared<const sago::tiled::TileMap>(world.tm);
+	queuedSaves.push_back(QueueFileWrite(mapFileName, [snapshot](std::ostream& out) {
+		sago::tiled::tilemap2binary(out, GetStoredRegion(*snapshot));
+	}, journalFileName));
+	// Assumed to succeed. FlushRegion saves everything again if it turns out that it did not
+	regionSaved = true;
+	journalBytes = 0;
+	journal.track(world.tm);
+}
+
+/**
+ * Collects the results of the queued writes of the region.
+ * @param wait Wait for the writes that are not done. Otherwise they are checked on a later call
+ * @return true if a write failed
+ */
+bool GameRegion::QueuedSavesFailed(bool wait) {
+	bool failed = false;
+	for (auto itr = queuedSaves.begin(); itr != queuedSaves.end(); ) {
+		if (!wait && itr->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++itr;
+			continue;
+		}
+		failed = !itr->get() || failed;
+		itr = queuedSaves.erase(itr);
+	}
+	return failed;
+}
+
+/**
+ * Waits for the writes of the region before it is left. A failed write is tried once more with a full save, as the region
+ * cannot be saved once it has been replaced.
+ */
+void GameRegion::FinishQueuedSaves() {
+	if (!QueuedSavesFailed(true)) {
+		return;
+	}
+	std::cerr << "Saving " << mapFileName << " again\n";
+	SaveRegion();
+	if (QueuedSavesFailed(true)) {
+		std::cerr << "Could not save " << mapFileName << ". The changes since it was last saved are lost\n";
+		regionSaved = false;
+	}
+}
+
+void GameRegion::FlushRegion() {
+	if (QueuedSavesFailed(false)) {
+		// The file on disk is missing changes, and journal blocks would be for a base that was never written
+		regionSaved = false;
+	}
+	if (!regionSaved) {
+		// New or saved in the old TMX format
+		SaveRegion();
+		return;
+	}
+	UpdateMutableObjects();
+	const std::string block = journal.takeChanges(world.tm, sago::tiled::getMapProperty(world.tm, "journal_base"));
+	if (block.empty()) {
+		return;
+	}
+	if (journalBytes + block.size() > (size_t)settings.journal_checkpoint_bytes) {
+		SaveRegion();
+		return;
+	}
+	queuedSaves.push_back(QueueFileAppend(journalFileName, block));
+	journalBytes += block.size();
+}
+
+void GameRegion::ApplyLayerCodec() {
+	try {
+		sago::tiled::setLayerCodec(world.tm, settings.layer_codec, settings.compression_level);
+	}
+	catch (sago::tiled::SagoTiledException& e) {
+		std::cerr << "Keeping the current layer codec: " << e.what() << "\n";
+	}
+}
+
+std::string GameRegion::ExportRegionTmx() {
+	ApplyLayerCodec();
+	sago::PhysfsOStream out(tmxFileName.c_str());
+	sago::tiled::tilemap2stream(out, world.tm);
+	if (!out.close()) {
+		std::cerr << "Failed to export " << tmxFileName << "\n";
+	}
+	return tmxFileName;
+}
+
+bool GameRegion::ImportRegionTmx() {
+	std::string tmx_file = sago::GetFileContent(tmxFileName);
+	if (tmx_file.empty()) {
+		return false;
+	}
+	std::shared_ptr<const sago::tiled::TileMap> tm = std::make_shared<const sago::tiled::TileMap>(sago::tiled::string2tilemap_inplace(&tmx_file[0]));
+	// A failed earlier save would otherwise be retried after the import and overwrite it
+	FinishQueuedSaves();
+	// The journal was made for the region that is replaced
+	std::future<bool> imported = QueueFileWrite(mapFileName, [tm](std::ostream& out) {
+		sago::tiled::tilemap2binary(out, *tm);
+	}, journalFileName);
+	if (!imported.get()) {
+		std::cerr << "Failed to import " << tmxFileName << ". The saved region is unchanged\n";
+		return false;
+	}
+	return true;
 }
 
@@ -26,10 +26,14 @@ https://github.com/sago007/saland
 
 #include "model/World.hpp"
 #include "model/placeables.hpp"
+#include "model/WorldSettings.hpp"
 #include "GameItems.hpp"
 #include "Prefabs.hpp"
-#include "../sagotmx/tmx_struct.h"
+#include "RegionArena.hpp"
+#include "../sagotmx/tmx_journal.h"
 #include "../terrain/WaterHandler.hpp"
+#include <future>
+#include <random>
 #include <vector>
 
 struct MonsterDef {
@@ -42,15 +46,70 @@ struct MonsterDef {
 
 
 
+/**
+ * A region read from disk and prepared as far as it can be without touching the running game.
+ * Made by LoadRegion, which may run on another thread.
+ */
+struct LoadedRegion {
+	int x = 0;
+	int y = 0;
+	std::string worldName;
+	bool newRegion = false;  //< If the region has just been generated from a template
+	WorldSettings settings;
+	World world;  //< Without physics
+	bool regionSaved = false;
+	size_t journalBytes = 0;
+};
+
 class GameRegion {
 public:
 	GameRegion();
 	void Init(int x, int y, const std::string& worldName, bool forceResetWorld);
 	void InitDungeon(const std::string& dungeonName, const std::string& dungeonType, bool forceResetWorld);
+	/**
+	 * Starts loading a region on a background thread, so a later Init of it only has to add the physics and spawn things.
+	 * Only one region is loaded at a time. The call is ignored while another region is being loaded.
+	 */
+	void PrefetchRegion(int x, int y, const std::string& worldName);
+	/**
+	 * Streaming mode (WorldSettings::streaming). Keeps the eight regions around the current one resident, so they can be drawn
+	 * across the borders. Missing neighbors are loaded in the background and regions that are no longer neighbors are evicted.
+	 * Call once per frame.
+	 * Only the maps are resident. Entering a neighbor skips reading it from disk, but it is otherwise a normal Init: The physics
+	 * is rebuilt and the entities are spawned again. Entities are not moved to the region they walk into.
+	 */
+	void UpdateResidentRegions();
+	/**
+	 * A region that has never been entered is not returned. Its first enter changes the map (like the lake of a forrest), and
+	 * it would visibly change when the player crosses over.
+	 * @return The resident region at an offset from the current region or nullptr if it is not loaded (yet) or never entered
+	 */
+	const World* GetResidentRegion(int dx, int dy) const;
+	RegionArena arena;  //< Memory of the entities of the region. Declared before placeables, so it outlives them
 	std::vector<std::shared_ptr<Placeable> > placeables;
 	std::shared_ptr<b2World> physicsBox;
+	/**
+	 * Saves the entire region and starts a new journal. Used at shutdown and when the journal has grown too large.
+	 * The region is written on the save thread. See SaveQueue.hpp
+	 */
 	void SaveRegion();
+	/**
+	 * Appends the changes since the region was last saved or flushed to the journal of the region.
+	 * Calls SaveRegion instead if the region has never been saved or the journal would grow past journal_checkpoint_bytes.
+	 */
+	void FlushRegion();
+	/**
+	 * Writes the current state of the region as TMX so that it can be edited in Tiled.
+	 * @return The filename of the TMX file relative to the save folder
+	 */
+	std::string ExportRegionTmx();
+	/**
+	 * Replaces the saved region with the content of the TMX file written by ExportRegionTmx. Waits until it has been written.
+	 * @return false if there was nothing to import or the region could not be written. The saved region is then unchanged
+	 */
+	bool ImportRegionTmx();
 	World world;
+	WorldSettings settings;
 	std::map<std::string, WaterHandler> liqudHandler;
 	uint32_t outerTile = 485;
 	int GetRegionX() const {
@@ -73,7 +132,26 @@ private:
 	int region_x = 0;
 	int region_y = 0;
 	std::string mapFileName = "maps/sample1.tmx";
+	std::string tmxFileName = "maps/sample1.tmx";
+	std::string journalFileName;
+	sago::tiled::TileMapJournal journal;  //< Tracks the state of the map as it is on disk
+	bool regionSaved = false;  //< If the region has been saved in the binary format
+	size_t journalBytes = 0;  //< Size of the journal including the queued appends
+	std::vector<std::future<bool> > queuedSaves;  //< Results of the queued writes of the region that have not been checked yet
+	std::string worldName;  //< The world of the current region. Empty in a dungeon
+	std::map<std::pair<int, int>, LoadedRegion> residentRegions;  //< The neighbors in streaming mode by region coordinates
+	std::map<std::pair<int, int>, std::future<LoadedRegion> > residentLoading;
+	std::future<LoadedRegion> prefetch;
+	int prefetchX = 0;
+	int prefetchY = 0;
+	std::string prefetchWorldName;
 	void InitCommon();
+	void InitLiquidHandlers();
+	void ApplyLayerCodec();
+	bool QueuedSavesFailed(bool wait);
+	void FinishQueuedSaves();
+	void UpdateMutableObjects();
+	void CreateLake(World& world, int tile_x, int tile_y, std::mt19937& gen);
 };
 
 #endif /* GAMEREGION_HPP */
@@ -27,6 +27,7 @@ https://github.com/sago007/saland
 #include <memory>
 #include "model/spells.hpp"
 #include "GameRegion.hpp"
+#include "GidAtlas.hpp"
 
 #include "../sago/GameStateInterface.hpp"
 
@@ -41,6 +42,7 @@ public:
 	bool IsSpellSelectActive();
 	std::shared_ptr<SpellHolder> spell_holder;
 	sago::tiled::TileMap* tm = nullptr;
+	const GidAtlas* atlas = nullptr;  //< Used to draw the tile icons. Kept up to date by the game
 private:
 	struct GameSpellStateImpl;
 	std::unique_ptr<GameSpellStateImpl> data;
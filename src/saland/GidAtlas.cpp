@@ -0,0 +1,93 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2021 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/salandgame/saland
+===========================================================================
+*/
+
+#include "GidAtlas.hpp"
+#include <iostream>
+#include <algorithm>
+
+static const sago::tiled::TileSet* ResolveTileSet(const sago::tiled::TileSet* ts) {
+	while (ts->alternativeSource) {
+		ts = ts->alternativeSource;
+	}
+	return ts;
+}
+
+/**
+ * The texture name is the image file without "../textures/" and the extension
+ */
+static std::string TextureNameFromImage(const std::string& imageFile) {
+	if (imageFile.length() < 16) {
+		return "";
+	}
+	return imageFile.substr(12, imageFile.length()-16);
+}
+
+void GidAtlas::Update(const sago::tiled::TileMap& tm, const sago::SagoDataHolder& holder) {
+	std::vector<TileSetKey> keys;
+	keys.reserve(tm.tileset.size());
+	for (const sago::tiled::TileSet& ts : tm.tileset) {
+		TileSetKey key;
+		key.firstgid = ts.firstgid;
+		key.resolved = ResolveTileSet(&ts);
+		key.image = key.resolved->image.source;
+		keys.push_back(key);
+	}
+	if (built && keys == tilesets && holder.getVersion() == holderVersion) {
+		return;
+	}
+	tilesets = keys;
+	holderVersion = holder.getVersion();
+	built = true;
+	entries.clear();
+	// Same rules as getTextureLocationFromGid: A gid belongs to the last tileset with a firstgid not above it
+	for (size_t i = 0; i < keys.size(); ++i) {
+		const sago::tiled::TileSet* ts = keys[i].resolved;
+		if (ts->image.width <= 0 || ts->tilewidth <= 0) {
+			std::cerr << "image: " << ts->image.source << " (" << ts->image.width << ", " << ts->image.height << ") is not good\n";
+			continue;
+		}
+		// tilecount is not always updated when the image grows, so trust the image
+		int tilecount = ts->tilecount;
+		if (ts->tileheight > 0) {
+			tilecount = std::max(tilecount, (ts->image.width/ts->tilewidth)*(ts->image.height/ts->tileheight));
+		}
+		size_t first = keys[i].firstgid;
+		size_t end = first + tilecount;
+		if (i+1 < keys.size() && static_cast<size_t>(keys[i+1].firstgid) < end) {
+			end = keys[i+1].firstgid;
+		}
+		if (entries.size() < end) {
+			entries.resize(end);
+		}
+		SDL_Texture* texture = holder.getTexturePtr(TextureNameFromImage(ts->image.source));
+		for (size_t gid = first; gid < end; ++gid) {
+			GidAtlasEntry& entry = entries[gid];
+			int local = gid - first;
+			entry.texture = texture;
+			entry.part.x = (local*ts->tilewidth)%ts->image.width;
+			entry.part.y = (local*ts->tilewidth)/ts->image.width*ts->tilewidth;
+			entry.part.w = ts->tilewidth;
+			entry.part.h = ts->tileheight;
+		}
+	}
+}
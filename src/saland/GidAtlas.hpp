@@ -0,0 +1,74 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2021 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/salandgame/saland
+===========================================================================
+*/
+
+#ifndef GIDATLAS_HPP
+#define GIDATLAS_HPP
+
+#include "../sagotmx/tmx_struct.h"
+#include "../sago/SagoDataHolder.hpp"
+#include "SDL.h"
+#include <vector>
+
+struct GidAtlasEntry {
+	SDL_Texture* texture = nullptr;  //< nullptr if the gid is not in any tileset
+	SDL_Rect part{};  //< The part of the texture to draw
+};
+
+/**
+ * Lookup table from gid to texture and source rectangle.
+ * Resolving a gid through the tilesets and the data holder is expensive, so it is done for all gids at once
+ * and drawing becomes a single array index per tile.
+ */
+class GidAtlas {
+public:
+	/**
+	 * Makes the atlas match the tilesets of the map and the current textures of the data holder.
+	 * Only rebuilds if the tilesets or the data holder version changed, so it can be called every frame.
+	 */
+	void Update(const sago::tiled::TileMap& tm, const sago::SagoDataHolder& holder);
+
+	/**
+	 * @return The entry for the gid or nullptr if there is nothing to draw
+	 */
+	const GidAtlasEntry* Get(uint32_t gid) const {
+		if (gid >= entries.size() || !entries[gid].texture) {
+			return nullptr;
+		}
+		return &entries[gid];
+	}
+private:
+	struct TileSetKey {
+		int firstgid = 0;
+		const sago::tiled::TileSet* resolved = nullptr;
+		std::string image;
+		bool operator==(const TileSetKey& other) const {
+			return firstgid == other.firstgid && resolved == other.resolved && image == other.image;
+		}
+	};
+	std::vector<GidAtlasEntry> entries;
+	std::vector<TileSetKey> tilesets;
+	Uint64 holderVersion = 0;
+	bool built = false;
+};
+
+#endif  //GIDATLAS_HPP
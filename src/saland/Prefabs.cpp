@@ -24,10 +24,12 @@ https://github.com/salandgame/saland
 #include "Prefabs.hpp"
 #include "../sago/SagoMisc.hpp"
 #include "../sagotmx/tmx_struct.h"
+#include "TiledAssetCache.hpp"
+#include <algorithm>
 
 
 std::vector<Prefab> prefabs;
-std::map<std::string, sago::tiled::TileMap> prefabTileMaps;
+std::map<std::string, std::shared_ptr<const sago::tiled::TileMap> > prefabTileMaps;  //The maps the prefabs were scanned from
 std::map<std::string, size_t> prefabs_map;
 
 static int GetLayerNumber(const sago::tiled::TileMap& tm, const char* name) {
@@ -62,19 +64,26 @@ static int32_t translate_tile(const sago::tiled::TileMap& dest, const sago::tile
 }
 
 void ApplyPrefabLayer(sago::tiled::TileMap& dest, int destX, int destY, const char* destLayer, const Prefab& prefab, const char* sourceLayer) {
-	const sago::tiled::TileMap& source = prefabTileMaps[prefab.filename];
+	const auto it = prefabTileMaps.find(prefab.filename);
+	if (it == prefabTileMaps.end()) {
+		return;
+	}
+	const sago::tiled::TileMap& source = *it->second;
 	int destLayerNumber = GetLayerNumber(dest, destLayer);
 	int sourceLayerNumber = GetLayerNumber(source, sourceLayer);
 	if (destLayerNumber < 0 || sourceLayerNumber < 0) {
 		return;
 	}
-	for (int i = 0; i < prefab.width; ++i) {
-		for (int j = 0; j < prefab.height; ++j) {
-			int32_t tile = sago::tiled::getTileFromLayer(source, source.layers.at(sourceLayerNumber), prefab.topx+i, prefab.topy+j);
-			tile = translate_tile(dest, source, tile);
-			sago::tiled::setTileOnLayerNumber(dest, destLayerNumber, destX+i, destY+j, tile);
+	//A prefab uses few distinct tiles, so each is only translated once
+	std::map<uint32_t, uint32_t> translated;
+	dest.layers.at(destLayerNumber).data.tiles.copyRect(source.layers.at(sourceLayerNumber).data.tiles, prefab.topx, prefab.topy, prefab.width, prefab.height,
+			destX, destY, [&](uint32_t tile) {
+		auto found = translated.find(tile);
+		if (found == translated.end()) {
+			found = translated.emplace(tile, translate_tile(dest, source, tile)).first;
 		}
-	}
+		return found->second;
+	});
 }
 
 void ApplyPrefabObjectMarker(sago::tiled::TileMap& dest, int destX, int destY, const Prefab& prefab) {
@@ -87,7 +96,7 @@ void ApplyPrefabObjectMarker(sago::tiled::TileMap& dest, int destX, int destY, c
 			o.y = destY*32+2;
 			o.width = prefab.width*32-4;
 			o.height = prefab.height*32-4;
-			group.objects.push_back(o);
+			group.add(o);
 		}
 	}
 }
@@ -127,15 +136,28 @@ void TestApplyPrefab(sago::tiled::TileMap& dest, int destX, int destY) {
 
 void ScanPrefabs(const std::string& filename) {
 	std::string mapFileName = "maps/"+filename+".tmx";
-	std::string tmx_file = sago::GetFileContent(mapFileName);
-	sago::tiled::TileMap tm = sago::tiled::string2tilemap(tmx_file);
-	prefabTileMaps[filename] = tm;
+	std::shared_ptr<const sago::tiled::TileMap> cached = GetCachedTileMap(mapFileName);
+	std::shared_ptr<const sago::tiled::TileMap>& scanned = prefabTileMaps[filename];
+	if (scanned == cached) {
+		//Already scanned and the file has not changed
+		return;
+	}
+	scanned = cached;
+	//Forget the prefabs from an older version of the file
+	prefabs.erase(std::remove_if(prefabs.begin(), prefabs.end(), [&filename](const Prefab& p) {
+		return p.filename == filename;
+	}), prefabs.end());
+	prefabs_map.clear();
+	for (size_t i = 0; i < prefabs.size(); ++i) {
+		prefabs_map[prefabs[i].name] = i;
+	}
+	const sago::tiled::TileMap& tm = *cached;
 	for (const auto& t : tm.object_groups) {
 		std::cout << "Prefab object group: " << t.name << "\n";
 		for (const auto& o : t.objects) {
 			Prefab p;
 			p.filename = filename;
-			p.name = o.name;
+			p.name = t.str(o.name);
 			p.topx = o.x/32;
 			p.topy = o.y/32;
 			p.width = (o.x+o.width)/32+1 - p.topx;
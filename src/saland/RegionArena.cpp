@@ -0,0 +1,58 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2021 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/salandgame/saland
+===========================================================================
+*/
+
+#include "RegionArena.hpp"
+#include <iostream>
+
+void RegionArena::reset() {
+	if (live) {
+		std::cerr << live << " entities outlived their region. The region memory is given back when they are gone\n";
+		releasePending = true;
+		return;
+	}
+	release();
+}
+
+void RegionArena::release() {
+	pool.release();
+	buffer.release();
+	releasePending = false;
+}
+
+void* RegionArena::do_allocate(size_t bytes, size_t alignment) {
+	void* ret = pool.allocate(bytes, alignment);
+	++live;
+	return ret;
+}
+
+void RegionArena::do_deallocate(void* p, size_t bytes, size_t alignment) {
+	pool.deallocate(p, bytes, alignment);
+	--live;
+	if (live == 0 && releasePending) {
+		release();
+	}
+}
+
+bool RegionArena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+	return this == &other;
+}
@@ -0,0 +1,70 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2021 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/salandgame/saland
+===========================================================================
+*/
+
+#ifndef REGIONARENA_HPP
+#define REGIONARENA_HPP
+
+#include <memory>
+#include <memory_resource>
+
+/**
+ * Memory for the entities of a region.
+ * The memory is taken from the system in large blocks, and all of it is given back at once when the region is left instead of
+ * one entity at a time. Entities created together also end up next to each other, which helps the loops over them.
+ * Memory of dead entities (like projectiles) is reused by new ones of the same size, so a region does not grow while it is played.
+ * The strings and vectors inside the entities are still on the heap. They are small and mostly fit in the object itself.
+ * Only for the main thread.
+ */
+class RegionArena : public std::pmr::memory_resource {
+public:
+	/**
+	 * Creates an object in the arena. The object and its shared_ptr control block are a single allocation.
+	 */
+	template <class T>
+	std::shared_ptr<T> make() {
+		return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(this));
+	}
+
+	/**
+	 * Gives back all the memory at once. If objects from the arena are still alive, it is given back when the last of them is gone.
+	 */
+	void reset();
+
+	/**
+	 * @return The number of objects from the arena that are alive
+	 */
+	size_t liveAllocations() const {
+		return live;
+	}
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+	void release();
+	std::pmr::monotonic_buffer_resource buffer{64*1024};
+	std::pmr::unsynchronized_pool_resource pool{&buffer};  //< Keeps the freed blocks for reuse
+	size_t live = 0;
+	bool releasePending = false;  //< reset was called while objects were alive
+};
+
+#endif  //REGIONARENA_HPP
@@ -0,0 +1,147 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2021 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/salandgame/saland
+===========================================================================
+*/
+
+#include "RegionBenchmark.hpp"
+#include "GameDraw.hpp"
+#include "globals.hpp"
+#include "model/World.hpp"
+#include "../sagotmx/tmx_binary.h"
+#include "../sago/SagoMisc.hpp"
+#include <chrono>
+#include <format>
+#include <iostream>
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+}
+
+/**
+ * The pattern repeated until the map is size x size tiles. The object groups are kept as they are, so they only cover the
+ * first copy of the pattern.
+ */
+static sago::tiled::TileMap BuildBenchmarkRegion(const sago::tiled::TileMap& pattern, int size) {
+	sago::tiled::TileMap ret = pattern;
+	ret.width = size;
+	ret.height = size;
+	ret.infinite = false;
+	ret.originx = 0;
+	ret.originy = 0;
+	for (sago::tiled::TileLayer& layer : ret.layers) {
+		sago::tiled::loadPendingChunks(layer, 0, 0, layer.data.tiles.width(), layer.data.tiles.height());
+		const sago::tiled::TileGrid source = layer.data.tiles;
+		sago::tiled::TileGrid tiles(size, size);
+		if (source.width() > 0 && source.height() > 0) {
+			for (int y = 0; y < size; y += source.height()) {
+				for (int x = 0; x < size; x += source.width()) {
+					tiles.copyRect(source, 0, 0, source.width(), source.height(), x, y);
+				}
+			}
+		}
+		layer.width = size;
+		layer.height = size;
+		layer.data.tiles = std::move(tiles);
+		layer.data.stored_bytes.clear();
+	}
+	return ret;
+}
+
+/**
+ * Approximate heap use of the tiles and the derived data of a world. Chunks shared between layers are counted once per layer.
+ */
+static size_t EstimateWorldBytes(const World& world, size_t& fixtures) {
+	size_t ret = 0;
+	for (const sago::tiled::TileLayer& layer : world.tm.layers) {
+		const sago::tiled::TileGrid& tiles = layer.data.tiles;
+		const size_t chunks = ((tiles.width()+sago::tiled::TileChunk::size-1)/sago::tiled::TileChunk::size)
+				*((tiles.height()+sago::tiled::TileChunk::size-1)/sago::tiled::TileChunk::size);
+		ret += chunks*sizeof(std::shared_ptr<sago::tiled::TileChunk>) + tiles.nonEmptyChunks()*sizeof(sago::tiled::TileChunk);
+	}
+	ret += world.blocking_tiles.size()/8 + world.protected_tiles.size()/8;
+	fixtures = world.count_fixtures();
+	ret += fixtures*(sizeof(b2Fixture)+sizeof(b2PolygonShape)+sizeof(b2FixtureProxy));
+	return ret;
+}
+
+static double MeasureDraw(SDL_Renderer* renderer, GidAtlas& atlas, const sago::tiled::TileMap& tm, int topx, int topy) {
+	const int frames = 50;
+	const auto start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frames; ++frame) {
+		atlas.Update(tm, globalData.spriteHolder->GetDataHolder());
+		for (size_t i = 0; i < tm.layers.size(); ++i) {
+			DrawLayer(renderer, atlas, tm, i, topx, topy, &globalData.logicalResize);
+		}
+	}
+	return SecondsSince(start)/frames;
+}
+
+void RunRegionBenchmark(SDL_Renderer* renderer, const sago::tiled::TileMap& pattern, int size) {
+	const std::string filename = std::format("benchmark_{}x{}.region", size, size);
+	std::cout << std::format("Region benchmark {}x{} tiles\n", size, size);
+	auto start = std::chrono::steady_clock::now();
+	sago::tiled::TileMap tm = BuildBenchmarkRegion(pattern, size);
+	std::cout << std::format("{:>12}: {:9.1f} ms\n", "build", SecondsSince(start)*1000.0);
+
+	start = std::chrono::steady_clock::now();
+	const std::string saved = sago::tiled::tilemap2binary(tm);
+	sago::WriteFileContent(filename.c_str(), saved);
+	std::cout << std::format("{:>12}: {:9.1f} ms, {} bytes\n", "save", SecondsSince(start)*1000.0, saved.size());
+
+	World world;
+	start = std::chrono::steady_clock::now();
+	world.load(filename);
+	const double loadSeconds = SecondsSince(start);
+	std::shared_ptr<b2World> physics = std::make_shared<b2World>(b2Vec2(0.0f, 0.0f));
+	start = std::chrono::steady_clock::now();
+	world.attach_physics(physics);
+	std::cout << std::format("{:>12}: {:9.1f} ms, physics {:.1f} ms\n", "load", loadSeconds*1000.0, SecondsSince(start)*1000.0);
+	sago::RemoveFile(filename.c_str());
+
+	size_t fixtures = 0;
+	const size_t bytes = EstimateWorldBytes(world, fixtures);
+	std::cout << std::format("{:>12}: {:9.1f} MB, {} fixtures\n", "memory", bytes/1000000.0, fixtures);
+
+	if (world.blockingLayer >= 0) {
+		const int x = size/2;
+		const int y = size/2;
+		const uint32_t old = world.tm.layers.at(world.blockingLayer).data.tiles.get(x, y);
+		start = std::chrono::steady_clock::now();
+		sago::tiled::setTileOnLayerNumber(world.tm, world.blockingLayer, x, y, old ? 0 : 607);
+		world.update_tiles(x, y, 1, 1);
+		const double editSeconds = SecondsSince(start);
+		start = std::chrono::steady_clock::now();
+		world.init_physics(physics);
+		std::cout << std::format("{:>12}: {:9.3f} ms, full physics rebuild {:.1f} ms\n", "block edit", editSeconds*1000.0, SecondsSince(start)*1000.0);
+	}
+
+	GidAtlas atlas;
+	const int screen_width = 1280;
+	const int screen_height = 720;
+	const std::pair<int, int> cameras[] = {
+		{0, 0},
+		{size*16-screen_width/2, size*16-screen_height/2},
+		{size*32-screen_width, size*32-screen_height},
+	};
+	for (const auto& [topx, topy] : cameras) {
+		std::cout << std::format("{:>12}: {:9.3f} ms at ({}, {})\n", "draw", MeasureDraw(renderer, atlas, world.tm, topx, topy)*1000.0, topx, topy);
+	}
+}
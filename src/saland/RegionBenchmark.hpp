@@ -0,0 +1,40 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2021 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/salandgame/saland
+===========================================================================
+*/
+
+#ifndef REGIONBENCHMARK_HPP
+#define REGIONBENCHMARK_HPP
+
+#include "../sagotmx/tmx_struct.h"
+#include "SDL.h"
+
+/**
+ * Measures how the engine copes with a large region. A size x size region is made by repeating the tiles of pattern.
+ * Reports save time, load time, memory, a single block edit and the time to draw the layers at fixed camera positions.
+ * The region is written to the save folder while measuring and removed afterwards. The report is written to stdout.
+ * @param renderer Used for the draw timings. Only the time spent issuing the draw calls is measured
+ * @param pattern The map to repeat. Normally the current region
+ * @param size Width and height of the region in tiles
+ */
+void RunRegionBenchmark(SDL_Renderer* renderer, const sago::tiled::TileMap& pattern, int size);
+
+#endif  //REGIONBENCHMARK_HPP
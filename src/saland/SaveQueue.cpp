@@ -0,0 +1,173 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2021 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/salandgame/saland
+===========================================================================
+*/
+
+#include "SaveQueue.hpp"
+#include "../sago/SagoMisc.hpp"
+#include "../sagotmx/layer_workers.h"
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+struct SaveJob {
+	std::string filename;
+	std::function<bool()> run;  //< Returns false if the file was not saved
+	std::promise<bool> result;
+};
+
+class SaveQueue {
+public:
+	~SaveQueue() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		queued.notify_all();
+		if (worker.joinable()) {
+			worker.join();
+		}
+	}
+
+	std::future<bool> push(const std::string& filename, std::function<bool()> run) {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!worker.joinable()) {
+			worker = std::thread(&SaveQueue::work, this);
+		}
+		jobs.push_back({filename, std::move(run), std::promise<bool>()});
+		std::future<bool> ret = jobs.back().result.get_future();
+		++pending[filename];
+		queued.notify_one();
+		return ret;
+	}
+
+	void wait(const std::string& filename) {
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&]() {
+			return pending.count(filename) == 0;
+		});
+	}
+
+	void waitAll() {
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&]() {
+			return pending.empty();
+		});
+	}
+private:
+	void work() {
+		// Compressing on the layer workers would make the game wait for the save when it loads chunks
+		sago::tiled::LayerWorkers::SerialScope serial;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			queued.wait(lock, [&]() {
+				return stopping || !jobs.empty();
+			});
+			if (jobs.empty()) {
+				return;  //Only stops when everything has been written
+			}
+			SaveJob job = std::move(jobs.front());
+			jobs.pop_front();
+			lock.unlock();
+			bool saved = false;
+			try {
+				saved = job.run();
+			}
+			catch (std::exception& e) {
+				std::cerr << "Failed to save " << job.filename << ": " << e.what() << "\n";
+			}
+			job.result.set_value(saved);
+			lock.lock();
+			if (--pending[job.filename] == 0) {
+				pending.erase(job.filename);
+			}
+			done.notify_all();
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable queued;
+	std::condition_variable done;
+	std::deque<SaveJob> jobs;
+	std::map<std::string, int> pending;  //< Number of queued or running jobs for each file
+	bool stopping = false;
+	std::thread worker;  //< Started by the first job
+};
+
+SaveQueue& GetSaveQueue() {
+	static SaveQueue queue;
+	return queue;
+}
+
+}  //namespace
+
+std::future<bool> QueueFileWrite(const std::string& filename, std::function<void(std::ostream&)> write, const std::string& obsoleteFile) {
+	return GetSaveQueue().push(filename, [filename, write, obsoleteFile]() {
+		const std::string tempFileName = filename+".tmp";
+		sago::PhysfsOStream out(tempFileName.c_str());
+		write(out);
+		// Synced before the rename, or a crash could leave the new name on a file whose content never reached the disk
+		if (!out.close() || !sago::SyncFile(tempFileName.c_str())) {
+			std::cerr << "Failed to save " << filename << "\n";
+			return false;
+		}
+		if (!sago::RenameFile(tempFileName.c_str(), filename.c_str())) {
+			return false;
+		}
+		if (obsoleteFile.length() && sago::FileExists(obsoleteFile.c_str())) {
+			sago::RemoveFile(obsoleteFile.c_str());
+		}
+		return true;
+	});
+}
+
+std::future<bool> QueueFileAppend(const std::string& filename, const std::string& content) {
+	return GetSaveQueue().push(filename, [filename, content]() {
+		if (!sago::AppendFileContent(filename.c_str(), content)) {
+			std::cerr << "Failed to append to " << filename << "\n";
+			return false;
+		}
+		return true;
+	});
+}
+
+void QueueFileRemove(const std::string& filename) {
+	GetSaveQueue().push(filename, [filename]() {
+		if (sago::FileExists(filename.c_str())) {
+			sago::RemoveFile(filename.c_str());
+		}
+		return true;
+	});
+}
+
+void WaitForQueuedFile(const std::string& filename) {
+	GetSaveQueue().wait(filename);
+}
+
+void WaitForAllQueuedFiles() {
+	GetSaveQueue().waitAll();
+}
@@ -0,0 +1,70 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2021 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/salandgame/saland
+===========================================================================
+*/
+
+#ifndef SAVEQUEUE_HPP
+#define SAVEQUEUE_HPP
+
+#include <functional>
+#include <future>
+#include <ostream>
+#include <string>
+
+/**
+ * Writes save files on a background thread so the game does not stop while a region is serialized and written.
+ * The operations are done one at a time in the order they were queued. Callers hand over a snapshot of what to save, like a
+ * copy of a TileMap. Copies of a TileMap share the tile chunks until the original is changed, so they are cheap.
+ * Anything that reads a file that might have queued operations must call WaitForQueuedFile first.
+ */
+
+/**
+ * Queues a write of a complete file. The content is written to a temporary file that is synced to disk and then replaces the
+ * file, so the file is either the old or the new version even if the game crashes.
+ * @param filename Path relative to the PhysFS write dir
+ * @param write Writes the content. Called on the save thread, so it must only use what it has captured.
+ * @param obsoleteFile A file that is removed once the file has been written, like a journal the file replaces. Empty for none
+ * @return Becomes true once the file has been replaced or false if it could not be written. The old file is then untouched
+ */
+std::future<bool> QueueFileWrite(const std::string& filename, std::function<void(std::ostream&)> write, const std::string& obsoleteFile = "");
+
+/**
+ * Queues content to be added to the end of a file
+ * @return Becomes false if the content could not be added
+ */
+std::future<bool> QueueFileAppend(const std::string& filename, const std::string& content);
+
+/**
+ * Queues the removal of a file. It is not an error if the file does not exist.
+ */
+void QueueFileRemove(const std::string& filename);
+
+/**
+ * Blocks until there are no queued operations for the file
+ */
+void WaitForQueuedFile(const std::string& filename);
+
+/**
+ * Blocks until everything queued has been done. Must be called before PhysFS is shut down.
+ */
+void WaitForAllQueuedFiles();
+
+#endif  //SAVEQUEUE_HPP
@@ -0,0 +1,88 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2021 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/salandgame/saland
+===========================================================================
+*/
+
+#include "TiledAssetCache.hpp"
+#include "../sago/SagoMisc.hpp"
+#include "../sagotmx/tmx_delta.h"
+#include <functional>
+#include <map>
+#include <mutex>
+
+template <class T>
+struct CacheEntry {
+	sago::FileStamp stamp;
+	size_t contentHash = 0;
+	std::shared_ptr<const T> value;
+};
+
+static std::mutex cacheMutex;
+
+template <class T>
+static std::shared_ptr<const T> GetCached(std::map<std::string, CacheEntry<T> >& cache, const std::string& filename, T (*parse)(char*)) {
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	sago::FileStamp stamp = sago::GetFileStamp(filename.c_str());
+	CacheEntry<T>& entry = cache[filename];
+	if (entry.value && stamp.valid() && entry.stamp == stamp) {
+		return entry.value;
+	}
+	std::string content = sago::GetFileContent(filename);
+	size_t contentHash = std::hash<std::string>()(content);
+	if (!entry.value || entry.contentHash != contentHash) {
+		entry.value = std::make_shared<const T>(parse(&content[0]));
+		entry.contentHash = contentHash;
+	}
+	entry.stamp = stamp;
+	return entry.value;
+}
+
+std::shared_ptr<const sago::tiled::TileSet> GetCachedTileSet(const std::string& filename) {
+	static std::map<std::string, CacheEntry<sago::tiled::TileSet> > tilesets;
+	return GetCached(tilesets, filename, sago::tiled::string2tileset_inplace);
+}
+
+/**
+ * Cached maps are shared and cannot load chunks later, so infinite maps are loaded entirely
+ */
+static sago::tiled::TileMap ParseTileMap(char* tmx_content) {
+	sago::tiled::TileMap tm = sago::tiled::string2tilemap_inplace(tmx_content);
+	sago::tiled::loadAllPendingChunks(tm);
+	return tm;
+}
+
+std::shared_ptr<const sago::tiled::TileMap> GetCachedTileMap(const std::string& filename) {
+	static std::map<std::string, CacheEntry<sago::tiled::TileMap> > tilemaps;
+	return GetCached(tilemaps, filename, ParseTileMap);
+}
+
+CachedTileMap GetCachedTileMapWithHash(const std::string& filename) {
+	static std::mutex hashMutex;
+	static std::map<std::string, CachedTileMap> hashes;
+	std::lock_guard<std::mutex> lock(hashMutex);
+	std::shared_ptr<const sago::tiled::TileMap> tm = GetCachedTileMap(filename);
+	CachedTileMap& entry = hashes[filename];
+	if (entry.map != tm) {
+		entry.contentHash = sago::tiled::tilemapContentHash(*tm);
+		entry.map = tm;
+	}
+	return entry;
+}
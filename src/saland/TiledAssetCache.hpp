@@ -0,0 +1,61 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2021 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/salandgame/saland
+===========================================================================
+*/
+
+#ifndef TILEDASSETCACHE_HPP
+#define TILEDASSETCACHE_HPP
+
+#include <memory>
+#include <string>
+#include "../sagotmx/tmx_struct.h"
+
+/**
+ * Process wide cache of parsed Tiled files that are only read, like external tilesets and prefab maps.
+ * Each file is parsed once and the result is shared.
+ * If the modification time or size of the file changes the content is read again. It is only parsed again if the content differs.
+ * Thread safe.
+ */
+
+/**
+ * Returns a parsed tsx file
+ * @param filename Path relative to the PhysFS root like "maps/terrain.tsx"
+ */
+std::shared_ptr<const sago::tiled::TileSet> GetCachedTileSet(const std::string& filename);
+
+/**
+ * Returns a parsed tmx file
+ * @param filename Path relative to the PhysFS root like "maps/prefabs01.tmx"
+ */
+std::shared_ptr<const sago::tiled::TileMap> GetCachedTileMap(const std::string& filename);
+
+struct CachedTileMap {
+	std::shared_ptr<const sago::tiled::TileMap> map;
+	std::string contentHash;  //< sago::tiled::tilemapContentHash of map
+};
+
+/**
+ * Returns a parsed tmx file together with its content hash. The hash is computed once each time the file is parsed
+ * @param filename Path relative to the PhysFS root like "maps/template_forrest.tmx"
+ */
+CachedTileMap GetCachedTileMapWithHash(const std::string& filename);
+
+#endif  //TILEDASSETCACHE_HPP
@@ -23,6 +23,11 @@ https://github.com/sago007/saland
 
 #include "World.hpp"
 #include "placeables.hpp"
+#include "../../sagotmx/tmx_binary.h"
+#include "../../sagotmx/tmx_delta.h"
+#include <algorithm>
+#include <iostream>
+#include "../TiledAssetCache.hpp"
 
 World::World() {
 }
@@ -73,32 +78,59 @@ static b2Body* AddStaticBody(b2World* world) {
 	return body;
 }
 
-static b2Body* AddStaticTilesToWorld(b2World* world, const sago::tiled::TileMap& tm, const sago::tiled::TileLayer& layer) {
-	b2Body* body = AddStaticBody(world);
-	for (int i = 0; i < tm.height; ++i) {
-		for (int j = 0; j < tm.width; ++j) {
-			uint32_t gid = sago::tiled::getTileFromLayer(tm, layer, i, j);
-			if (gid == 0) {
-				continue;
+/**
+ * Adds a static body with the blocking tiles of a rectangle of the map.
+ * The tiles are merged greedily into as few rectangles as possible: Each run of blocking tiles along a row is extended downwards
+ * while the rows below have the same run. Fewer fixtures make stepping the world cheaper. The rectangles still have internal
+ * edges between them and at the chunk borders.
+ * @param blocking_tiles The blocking state of every tile of the map. See World::update_blocking_tiles
+ * @return The body or nullptr if there are no blocking tiles in the rectangle
+ */
+static b2Body* AddStaticTilesToWorld(b2World* world, const std::vector<bool>& blocking_tiles, int mapWidth, int mapHeight, int x, int y, int w, int h) {
+	w = std::min(w, mapWidth-x);
+	h = std::min(h, mapHeight-y);
+	if (w <= 0 || h <= 0) {
+		return nullptr;
+	}
+	std::vector<uint8_t> blocking(static_cast<size_t>(w)*h, 0);
+	bool any = false;
+	for (int j = 0; j < h; ++j) {
+		for (int i = 0; i < w; ++i) {
+			if (blocking_tiles[(x+i)+(y+j)*mapWidth]) {
+				blocking[j*w+i] = 1;
+				any = true;
 			}
-			AddRectToBody(body, i*32.0f, j*32.0f, 32.0f, 32.0f);
 		}
 	}
-	return body;
-}
-
-void fill_blocking_tiles(std::vector<bool>& output, const sago::tiled::TileMap& tm, const sago::tiled::TileLayer& layer) {
-	output.resize(tm.height*tm.width);
-	for (int i = 0; i < tm.height; ++i) {
-		for (int j = 0; j < tm.width; ++j) {
-			output[i+j*tm.width] = false;
-			uint32_t gid = sago::tiled::getTileFromLayer(tm, layer, i, j);
-			if (gid == 0) {
+	if (!any) {
+		return nullptr;
+	}
+	b2Body* body = AddStaticBody(world);
+	for (int j = 0; j < h; ++j) {
+		for (int i = 0; i < w; ++i) {
+			if (!blocking[j*w+i]) {
 				continue;
 			}
-			output[i+j*tm.width] = true;
+			int runWidth = 1;
+			while (i+runWidth < w && blocking[j*w+i+runWidth]) {
+				++runWidth;
+			}
+			int runHeight = 1;
+			while (j+runHeight < h) {
+				const auto row = blocking.begin()+(j+runHeight)*w+i;
+				if (!std::all_of(row, row+runWidth, [](uint8_t b) { return b != 0; })) {
+					break;
+				}
+				++runHeight;
+			}
+			for (int k = 0; k < runHeight; ++k) {
+				const auto row = blocking.begin()+(j+k)*w+i;
+				std::fill(row, row+runWidth, 0);
+			}
+			AddRectToBody(body, (x+i)*32.0f, (y+j)*32.0f, runWidth*32.0f, runHeight*32.0f);
 		}
 	}
+	return body;
 }
 
 void destroyBodyWithFixtures(b2World* world, b2Body*& bodyToDestroy) {
@@ -123,26 +155,33 @@ void World::init_physics(std::shared_ptr<b2World>& world) {
 		world->DestroyBody(b);*/
 	}
 	managed_bodies.clear();
+	for (b2Body*& b : blocking_chunk_bodies) {
+		if (b) {
+			destroyBodyWithFixtures(world.get(), b);
+		}
+	}
+	blocking_chunk_bodies.clear();
 	const std::vector<sago::tiled::TileObjectGroup>& object_groups = tm.object_groups;
 	for (const auto& group : object_groups) {
 		for (const auto& item : group.objects) {
 			if (item.isEllipse) {
 				continue;
 			}
-			if (item.x > 0 && item.y > 0 && item.width > 0 && item.height > 0 && item.type == "blocking") {
+			if (item.x > 0 && item.y > 0 && item.width > 0 && item.height > 0 && item.kind == sago::tiled::ObjectType::blocking) {
 				b2Body* bodyAdded = AddStaticRect(physicsWorld.get(), item.x, item.y, item.width, item.height);
 				managed_bodies.push_back(bodyAdded);
 			}
 		}
 	}
 	const std::vector<sago::tiled::TileLayer>& layers = tm.layers;
-	for (const auto& layer : layers) {
-		if (layer.name != "blocking") {
-			continue;
+	update_blocking_tiles(0, 0, tm.width, tm.height);
+	if (blockingLayer >= 0) {
+		const int size = sago::tiled::TileChunk::size;
+		blocking_chunks_x = (tm.width+size-1)/size;
+		blocking_chunk_bodies.assign(blocking_chunks_x*((tm.height+size-1)/size), nullptr);
+		for (size_t i = 0; i < blocking_chunk_bodies.size(); ++i) {
+			update_blocking_chunk(i%blocking_chunks_x, i/blocking_chunks_x);
 		}
-		b2Body* bodyAdded = AddStaticTilesToWorld(physicsWorld.get(), tm, layer);
-		managed_bodies.push_back(bodyAdded);
-		fill_blocking_tiles(blocking_tiles, tm, layer);
 	}
 	{
 		//Top left
@@ -282,19 +321,126 @@ static void init_tilemap(sago::tiled::TileMap& tm, int& ground2Layer, int& groun
 }
 
 void World::init(std::shared_ptr<b2World>& world, const std::string& mapFileName) {
+	load(mapFileName);
+	attach_physics(world);
+}
+
+void World::attach_physics(std::shared_ptr<b2World>& world) {
 	this->physicsWorld = world;
-	std::string tmx_file = sago::GetFileContent(mapFileName);
-	tm = sago::tiled::string2tilemap(tmx_file);
+	init_physics(world);
+}
+
+void World::detach_physics() {
+	physicsWorld.reset();
+	managed_bodies.clear();
+	blocking_chunk_bodies.clear();
+}
+
+void World::update_blocking_chunk(int cx, int cy) {
+	b2Body*& body = blocking_chunk_bodies.at(cx+cy*blocking_chunks_x);
+	if (body) {
+		destroyBodyWithFixtures(physicsWorld.get(), body);
+	}
+	const int size = sago::tiled::TileChunk::size;
+	body = AddStaticTilesToWorld(physicsWorld.get(), blocking_tiles, tm.width, tm.height, cx*size, cy*size, size, size);
+}
+
+void World::update_blocking_tiles(int x, int y, int w, int h) {
+	blocking_tiles.resize(static_cast<size_t>(tm.width)*tm.height);
+	const int startX = std::max(x, 0);
+	const int endX = std::min(x+w, tm.width);
+	const int startY = std::max(y, 0);
+	const int endY = std::min(y+h, tm.height);
+	if (startX >= endX || startY >= endY) {
+		return;
+	}
+	for (int j = startY; j < endY; ++j) {
+		std::fill(blocking_tiles.begin()+startX+j*tm.width, blocking_tiles.begin()+endX+j*tm.width, false);
+	}
+	// The other layers only have to be looked at if the tilesets have tiles with the blocking property
+	const bool blockingProperty = tileAttributes.anyHasFlag(sago::tiled::TILE_BLOCKING);
+	for (size_t l = 0; l < tm.layers.size(); ++l) {
+		const bool blockingLayerTiles = static_cast<int>(l) == blockingLayer;
+		if (!blockingLayerTiles && !blockingProperty) {
+			continue;
+		}
+		tm.layers[l].data.tiles.forEachNonZero(startX, startY, endX-startX, endY-startY, [&](int i, int j, uint32_t tile) {
+			if (blockingLayerTiles || tileAttributes.hasFlag(tile, sago::tiled::TILE_BLOCKING)) {
+				blocking_tiles[i+j*tm.width] = true;
+			}
+		});
+	}
+}
+
+static size_t CountFixtures(const std::vector<b2Body*>& bodies) {
+	size_t ret = 0;
+	for (const b2Body* body : bodies) {
+		for (const b2Fixture* f = body ? body->GetFixtureList() : nullptr; f; f = f->GetNext()) {
+			++ret;
+		}
+	}
+	return ret;
+}
+
+size_t World::count_fixtures() const {
+	return CountFixtures(managed_bodies)+count_blocking_fixtures();
+}
+
+size_t World::count_blocking_fixtures() const {
+	return CountFixtures(blocking_chunk_bodies);
+}
+
+void World::update_tiles(int x, int y, int w, int h) {
+	update_blocking_tiles(x, y, w, h);
+	if (!physicsWorld || blocking_chunk_bodies.empty() || w <= 0 || h <= 0) {
+		return;
+	}
+	// Only the chunks touched by the rectangle are rebuilt
+	const int size = sago::tiled::TileChunk::size;
+	const int chunksY = blocking_chunk_bodies.size()/blocking_chunks_x;
+	for (int cy = std::max(y/size, 0); cy <= std::min((y+h-1)/size, chunksY-1); ++cy) {
+		for (int cx = std::max(x/size, 0); cx <= std::min((x+w-1)/size, blocking_chunks_x-1); ++cx) {
+			update_blocking_chunk(cx, cy);
+		}
+	}
+}
+
+void World::load(const std::string& mapFileName) {
+	detach_physics();
+	std::string map_file = sago::GetFileContent(mapFileName);
+	if (sago::tiled::isBinaryTilemap(map_file)) {
+		tm = sago::tiled::binary2tilemap(map_file);
+		if (sago::tiled::isTilemapDelta(tm)) {
+			// Only the changes to a template were saved. See GetStoredRegion in GameRegion.cpp
+			const CachedTileMap base = GetCachedTileMapWithHash(sago::tiled::tilemapDeltaTemplate(tm));
+			if (!sago::tiled::tilemapDeltaMatches(base.contentHash, tm)) {
+				std::cerr << "The template of " << mapFileName << " has changed. Unchanged tiles will follow the new template\n";
+			}
+			tm = sago::tiled::applyTilemapDelta(*base.map, tm);
+		}
+	}
+	else {
+		tm = sago::tiled::string2tilemap_inplace(&map_file[0]);
+	}
 	// We run though all the externally referenced tilesets to inject them into the tilemap
+	ts.clear();
 	for (size_t i = 0; i < tm.tileset.size(); ++i) {
 		if (tm.tileset[i].source.length()) {
-			std::string tsx_file = sago::GetFileContent("maps/"+tm.tileset[i].source);
-			ts.push_back(sago::tiled::string2tileset(tsx_file));
-			tm.tileset[i].alternativeSource = &ts.back();
+			ts.push_back(GetCachedTileSet("maps/"+tm.tileset[i].source));
+			tm.tileset[i].alternativeSource = ts.back().get();
 		}
 	}
+	tileAttributes = sago::tiled::buildTileAttributes(tm);
 	init_tilemap(tm, ground2Layer, ground2OverlayLayer, blockingLayer, blockingLayer_overlay_1);
-	init_physics(world);
+	// The physics covers the entire map, so the chunks of infinite maps that can have blocking tiles are needed up front. The rest is
+	// loaded near the camera
+	const bool blockingProperty = tileAttributes.anyHasFlag(sago::tiled::TILE_BLOCKING);
+	for (sago::tiled::TileLayer& layer : tm.layers) {
+		if (layer.name == "blocking" || blockingProperty) {
+			sago::tiled::loadPendingChunks(layer, 0, 0, tm.width, tm.height);
+		}
+	}
+	update_blocking_tiles(0, 0, tm.width, tm.height);
 	protected_tiles.resize(tm.height*tm.width);
 
 	for (int x=0; x < tm.width; ++x) {
@@ -345,6 +491,24 @@ bool World::tile_protected(int x, int y) const {
 	return protected_tiles.at(index);
 }
 
+size_t World::load_chunks_near(int x, int y, int radiusX, int radiusY) {
+	if (!tm.infinite) {
+		return 0;
+	}
+	return sago::tiled::loadPendingChunks(tm, x-radiusX, y-radiusY, 2*radiusX+1, 2*radiusY+1);
+}
+
+float World::tile_speed(int x, int y) const {
+	float ret = 1.0f;
+	for (const sago::tiled::TileLayer& layer : tm.layers) {
+		const uint32_t tile = layer.data.tiles.get(x, y);
+		if (tile) {
+			ret = std::min(ret, tileAttributes.get(tile).speed);
+		}
+	}
+	return ret;
+}
+
 bool World::tile_blocking(int x, int y) const {
 	size_t index = x+y*tm.width;
 	return blocking_tiles.at(index);
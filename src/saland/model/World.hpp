@@ -25,29 +25,82 @@ https://github.com/sago007/saland
 #define WORLD_HPP
 
 #include "../../sagotmx/tmx_struct.h"
+#include "../../sagotmx/tile_attributes.h"
 #include "../../sago/SagoMisc.hpp"
 #include <box2d/box2d.h>
-#include <list>
+#include <vector>
+#include <memory>
 
 class World {
 public:
 	World();
 	void init(std::shared_ptr<b2World>& world);
 	void init(std::shared_ptr<b2World>& world, const std::string& mapFileName);
+	/**
+	 * Reads and prepares a map without creating any physics. Does not touch anything outside the World, so it can be done on
+	 * another thread for a World that is not in use. attach_physics must be called before the World is used.
+	 */
+	void load(const std::string& mapFileName);
+	/**
+	 * Adds the static bodies of a loaded map to a physics world
+	 */
+	void attach_physics(std::shared_ptr<b2World>& world);
+	/**
+	 * Forgets the static bodies without destroying them. For when the physics world is about to be destroyed anyway.
+	 * attach_physics must be called again before the World is used.
+	 */
+	void detach_physics();
 	void init_physics(std::shared_ptr<b2World>& world);
+	/**
+	 * Must be called after tiles that may block have been changed: Tiles of the blocking layer or tiles with the blocking
+	 * property on any layer. Only the blocking state of the rectangle is updated
+	 * and only the collision of the chunks touched by the rectangle is rebuilt. The cost follows the size of the change.
+	 * @param x X coordinate of the first changed tile
+	 * @param y Y coordinate of the first changed tile
+	 * @param w Width of the changed rectangle in tiles
+	 * @param h Height of the changed rectangle in tiles
+	 */
+	void update_tiles(int x, int y, int w, int h);
+	/**
+	 * @return The number of static fixtures
+	 */
+	size_t count_fixtures() const;
+	/**
+	 * @return The number of fixtures of the blocking layer
+	 */
+	size_t count_blocking_fixtures() const;
 	bool tile_protected(int x, int y) const;
 	bool tile_blocking(int x, int y) const;
+	/**
+	 * @return The walk speed multiplier of a tile. The lowest speed property of the tiles on all the layers. 1.0 outside the map
+	 */
+	float tile_speed(int x, int y) const;
+	/**
+	 * Decodes the chunks of an infinite map that are near a tile. Does nothing for other maps.
+	 * @param x X coordinate of the tile
+	 * @param y Y coordinate of the tile
+	 * @param radiusX Tiles to load to the left and to the right of x
+	 * @param radiusY Tiles to load above and below y
+	 * @return The number of chunks decoded
+	 */
+	size_t load_chunks_near(int x, int y, int radiusX, int radiusY);
 //private:
-	std::list<sago::tiled::TileSet> ts;  //External tilesets. Loaded into a list, so that references to the content does not become invalid
+	std::vector<std::shared_ptr<const sago::tiled::TileSet> > ts;  //External tilesets. Shared with the asset cache, so the alternativeSource pointers stay valid
 	sago::tiled::TileMap tm;
+	sago::tiled::TileAttributeTable tileAttributes;  //Built from the tilesets when the map is loaded
 	std::shared_ptr<b2World> physicsWorld;
 	std::vector<b2Body*> managed_bodies;
+	std::vector<b2Body*> blocking_chunk_bodies;  //< The collision of the blocking layer. One body per TileChunk, nullptr for chunks without blocking tiles
+	int blocking_chunks_x = 0;  //< Chunks per row in blocking_chunk_bodies
 	std::vector<bool> protected_tiles;
-	std::vector<bool> blocking_tiles;
+	std::vector<bool> blocking_tiles;  //< Tiles of the blocking layer and tiles with the blocking property on any layer
 	int ground2Layer = -1;
 	int ground2OverlayLayer = -1;
 	int blockingLayer = -1;
 	int blockingLayer_overlay_1 = -1;
+private:
+	void update_blocking_chunk(int cx, int cy);
+	void update_blocking_tiles(int x, int y, int w, int h);
 };
 
 /**
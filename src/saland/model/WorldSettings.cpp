@@ -0,0 +1,97 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2019 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/sago007/saland
+===========================================================================
+*/
+
+#include "WorldSettings.hpp"
+#include "../../sago/SagoMisc.hpp"
+#include "../../sagotmx/tmx_struct.h"
+#include <iostream>
+#include <random>
+
+void to_json(nlohmann::json& j, const WorldSettings& s) {
+	j = nlohmann::json{ {"layer_codec", s.layer_codec}, {"compression_level", s.compression_level},
+		{"journal_checkpoint_bytes", s.journal_checkpoint_bytes}, {"streaming", s.streaming},
+		{"seed", s.seed}, {"procedural_regions", s.procedural_regions},
+		{"physics_active_radius", s.physics_active_radius}, {"physics_lod_hysteresis", s.physics_lod_hysteresis} };
+}
+
+void from_json(const nlohmann::json& j, WorldSettings& s) {
+	if (j.contains("layer_codec")) {
+		j.at("layer_codec").get_to(s.layer_codec);
+	}
+	if (j.contains("compression_level")) {
+		j.at("compression_level").get_to(s.compression_level);
+	}
+	if (j.contains("journal_checkpoint_bytes")) {
+		j.at("journal_checkpoint_bytes").get_to(s.journal_checkpoint_bytes);
+	}
+	if (j.contains("streaming")) {
+		j.at("streaming").get_to(s.streaming);
+	}
+	if (j.contains("seed")) {
+		j.at("seed").get_to(s.seed);
+	}
+	if (j.contains("procedural_regions")) {
+		j.at("procedural_regions").get_to(s.procedural_regions);
+	}
+	if (j.contains("physics_active_radius")) {
+		j.at("physics_active_radius").get_to(s.physics_active_radius);
+	}
+	if (j.contains("physics_lod_hysteresis")) {
+		j.at("physics_lod_hysteresis").get_to(s.physics_lod_hysteresis);
+	}
+}
+
+WorldSettings LoadWorldSettings(const std::string& worldName) {
+	WorldSettings settings;
+	std::string filename = std::string("worlds/")+worldName+"/world.json";
+	if (sago::FileExists(filename.c_str())) {
+		try {
+			settings = nlohmann::json::parse(sago::GetFileContent(filename));
+		}
+		catch (std::exception& e) {
+			std::cerr << "Failed to read " << filename << ": " << e.what() << "\n";
+		}
+		// Frozen creatures wake up at physics_active_radius-physics_lod_hysteresis. At 0 or less they would never wake up
+		if (settings.physics_active_radius > 0.0f && (settings.physics_lod_hysteresis < 0.0f || settings.physics_lod_hysteresis >= settings.physics_active_radius)) {
+			const WorldSettings defaults;
+			std::cerr << filename << ": physics_lod_hysteresis must be at least 0 and smaller than physics_active_radius. Using "
+				<< defaults.physics_active_radius << " and " << defaults.physics_lod_hysteresis << "\n";
+			settings.physics_active_radius = defaults.physics_active_radius;
+			settings.physics_lod_hysteresis = defaults.physics_lod_hysteresis;
+		}
+		const bool uncompressed = settings.layer_codec == "csv" || settings.layer_codec == "base64";
+		if (!uncompressed && !sago::tiled::hasLayerCompression(settings.layer_codec)) {
+			const WorldSettings defaults;
+			std::cerr << filename << ": The layer codec \"" << settings.layer_codec << "\" is not available in this build. Regions saved with it "
+				<< "cannot be loaded. New saves use " << defaults.layer_codec << "\n";
+			settings.layer_codec = defaults.layer_codec;
+		}
+	}
+	else {
+		std::random_device rd;
+		settings.seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+		nlohmann::json j = settings;
+		sago::WriteFileContent(filename.c_str(), j.dump(4));
+	}
+	return settings;
+}
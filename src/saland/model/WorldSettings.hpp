@@ -0,0 +1,59 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2019 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/sago007/saland
+===========================================================================
+*/
+
+#ifndef WORLDSETTINGS_HPP
+#define WORLDSETTINGS_HPP
+
+#include <string>
+#include "nlohmann/json.hpp"
+
+/**
+ * Settings that belong to a single world. Stored in worlds/<name>/world.json
+ */
+struct WorldSettings {
+	/**
+	 * How saved regions store their layers. One of sago::tiled::getLayerCodecNames().
+	 * Uncompressed by default, so loading a region does not inflate and every build can read the world. zstd is smaller, but
+	 * only builds with SAGOTMX_WITH_ZSTD can read a world that uses it. zlib is for maps that must be opened in Tiled
+	 */
+	std::string layer_codec = "base64";
+	int compression_level = -1;  //< -1 for the default of the codec
+	int journal_checkpoint_bytes = 64*1024;  //< A region is saved in full instead of appending to its journal once the journal would grow past this
+	uint64_t seed = 0;  //< Seed of the generated regions. A random seed is picked when the settings are first written
+	bool procedural_regions = true;  //< Generate new regions from the seed. Otherwise they are plain copies of the templates
+	float physics_active_radius = 40.0f;  //< Creatures further away from the player in tiles are frozen. 0 to simulate everything
+	float physics_lod_hysteresis = 8.0f;  //< Frozen creatures wake up this many tiles inside physics_active_radius. Must be smaller than it
+	bool streaming = false;  //< Keep the neighbor regions loaded and show them across the borders. See GameRegion::UpdateResidentRegions
+};
+
+void to_json(nlohmann::json& j, const WorldSettings& s);
+void from_json(const nlohmann::json& j, WorldSettings& s);
+
+/**
+ * Reads the settings of a world. If the world has no settings file the defaults are written so they can be edited.
+ * @param worldName The name of the world folder
+ * @return The settings
+ */
+WorldSettings LoadWorldSettings(const std::string& worldName);
+
+#endif  //WORLDSETTINGS_HPP
@@ -59,6 +59,8 @@ public:
 	float health = 10.0;
 	float X = 20.0;
 	float Y = 20.0;
+	float prevX = 20.0;  //< X at the previous simulation tick. Used to draw between ticks
+	float prevY = 20.0;
 	float Radius = 14.0;
 	bool removeMe = false;
 	bool destructible = true;
@@ -0,0 +1,190 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2020 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/sago007/saland
+===========================================================================
+*/
+
+#include "RegionGenerator.hpp"
+#include "WaterHandler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+static const float waterLevel = 0.28f;  //< Tiles with a lower elevation are water
+static const float dryLevel = 0.38f;  //< Tiles with a lower moisture are ground
+static const uint64_t moistureSeed = 0x5DEECE66DULL;  //< Makes the moisture noise differ from the elevation noise
+
+static uint64_t Mix(uint64_t h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static uint64_t LatticeHash(uint64_t seed, int x, int y) {
+	return Mix(seed ^ (static_cast<uint64_t>(static_cast<uint32_t>(x))*0x9E3779B97F4A7C15ULL)
+			^ (static_cast<uint64_t>(static_cast<uint32_t>(y))*0xC2B2AE3D27D4EB4FULL));
+}
+
+/**
+ * Value of a lattice point between 0 and 1
+ */
+static float LatticeValue(uint64_t seed, int x, int y) {
+	return (LatticeHash(seed, x, y) >> 40)*(1.0f/16777216.0f);
+}
+
+static int FloorDiv(int a, int b) {
+	return a >= 0 ? a/b : -((-a+b-1)/b);
+}
+
+static float Smooth(float t) {
+	return t*t*(3.0f-2.0f*t);
+}
+
+/**
+ * Adds one octave of value noise for a row of tiles to out.
+ * The lattice values are looked up once per cell and the inner loop is plain arithmetic over an array, so the compiler can
+ * vectorize it.
+ * @param x0 World tile coordinate of out[0]
+ * @param y World tile coordinate of the row
+ * @param cell Distance between lattice points in tiles
+ */
+static void AddNoiseRow(uint64_t seed, int x0, int y, int count, int cell, float amplitude, float* out) {
+	const int cy = FloorDiv(y, cell);
+	const float wy = Smooth((y-cy*cell+0.5f)/cell);
+	const float invCell = 1.0f/cell;
+	int i = 0;
+	while (i < count) {
+		const int cx = FloorDiv(x0+i, cell);
+		const int run = std::min(count-i, (cx+1)*cell-(x0+i));
+		const float left = LatticeValue(seed, cx, cy)+(LatticeValue(seed, cx, cy+1)-LatticeValue(seed, cx, cy))*wy;
+		const float right = LatticeValue(seed, cx+1, cy)+(LatticeValue(seed, cx+1, cy+1)-LatticeValue(seed, cx+1, cy))*wy;
+		const float start = x0+i-cx*cell+0.5f;
+		float* row = out+i;
+		for (int k = 0; k < run; ++k) {
+			const float t = (start+k)*invCell;
+			const float wx = t*t*(3.0f-2.0f*t);
+			row[k] += amplitude*(left+(right-left)*wx);
+		}
+		i += run;
+	}
+}
+
+/**
+ * Fractal noise between 0 and 1. The largest cell is the scale of biomes spanning several regions.
+ */
+static void FractalNoiseRow(uint64_t seed, int x0, int y, int count, int biomeCell, float* out) {
+	std::fill(out, out+count, 0.0f);
+	AddNoiseRow(seed, x0, y, count, biomeCell, 0.4f, out);
+	AddNoiseRow(seed+1, x0, y, count, 32, 0.3f, out);
+	AddNoiseRow(seed+2, x0, y, count, 16, 0.2f, out);
+	AddNoiseRow(seed+3, x0, y, count, 8, 0.1f, out);
+}
+
+uint64_t RegionSeed(uint64_t worldSeed, int region_x, int region_y) {
+	return LatticeHash(Mix(worldSeed), region_x, region_y);
+}
+
+std::string GetGeneratedBiome(uint64_t worldSeed, int region_x, int region_y, int regionWidth, int regionHeight) {
+	// Only the slowest octave, so a biome covers several regions
+	float moisture = 0.0f;
+	AddNoiseRow(worldSeed^moistureSeed, region_x*regionWidth+regionWidth/2, region_y*regionHeight+regionHeight/2, 1, regionWidth*4, 1.0f, &moisture);
+	return moisture < 0.45f ? "desert" : "forrest";
+}
+
+/**
+ * If the tile must be walkable. The gates in the middle of the borders, so regions can always be entered, and near the
+ * player start.
+ */
+static bool KeepClear(const sago::tiled::TileMap& tm, const std::vector<std::pair<int, int> >& starts, int x, int y) {
+	const int margin = 4;
+	const bool gateColumn = x > tm.width/2-8 && x < tm.width/2+7;
+	const bool gateRow = y > tm.height/2-8 && y < tm.height/2+7;
+	if ((gateColumn && (y < margin || y >= tm.height-margin)) || (gateRow && (x < margin || x >= tm.width-margin))) {
+		return true;
+	}
+	for (const auto& [sx, sy] : starts) {
+		if (std::abs(sx-x) <= 3 && std::abs(sy-y) <= 3) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void GenerateRegion(sago::tiled::TileMap& tm, const RegionGeneratorLayers& layers, const sago::tiled::TileAttributeTable& attributes,
+		uint64_t worldSeed, int region_x, int region_y) {
+	if (layers.blockingLayer < 0 || layers.ground2Layer < 0 || tm.width <= 0 || tm.height <= 0) {
+		return;
+	}
+	const int width = tm.width;
+	const int height = tm.height;
+	const int worldX = region_x*width;
+	const int worldY = region_y*height;
+	const uint32_t waterTile = attributes.autotileGid("water");
+	const uint32_t groundTile = attributes.autotileGid("ground");
+	if (!waterTile || !groundTile) {
+		std::cerr << "Cannot generate the region. The tileset has no \"water\" or \"ground\" autotile\n";
+		return;
+	}
+	std::vector<float> elevation(static_cast<size_t>(width)*height);
+	std::vector<float> moisture(elevation.size());
+	for (int y = 0; y < height; ++y) {
+		FractalNoiseRow(worldSeed, worldX, worldY+y, width, width*2, &elevation[static_cast<size_t>(y)*width]);
+		FractalNoiseRow(worldSeed^moistureSeed, worldX, worldY+y, width, width*4, &moisture[static_cast<size_t>(y)*width]);
+	}
+	std::vector<std::pair<int, int> > starts;
+	for (const sago::tiled::TileObjectGroup& group : tm.object_groups) {
+		for (const sago::tiled::ObjectRecord& o : group.objects) {
+			if (o.kind == sago::tiled::ObjectType::playerStart) {
+				starts.emplace_back(o.x/32, o.y/32);
+			}
+		}
+	}
+	sago::tiled::TileGrid& blocking = tm.layers.at(layers.blockingLayer).data.tiles;
+	sago::tiled::TileGrid& ground = tm.layers.at(layers.ground2Layer).data.tiles;
+	for (int y = 0; y < height; ++y) {
+		for (int x = 0; x < width; ++x) {
+			const size_t i = static_cast<size_t>(y)*width+x;
+			if (elevation[i] < waterLevel && !KeepClear(tm, starts, x, y)) {
+				blocking.set(x, y, waterTile);
+			}
+			else if (moisture[i] < dryLevel) {
+				ground.set(x, y, groundTile);
+			}
+		}
+	}
+	WaterHandler water;
+	water.blockingLayer = layers.blockingLayer;
+	water.blockingLayer_overlay_1 = layers.blockingLayer_overlay_1;
+	water.setupTiles(waterTile);
+	water.setupAttributes(attributes, "water");
+	water.updateRect(tm, 0, 0, width, height);
+	if (layers.ground2OverlayLayer >= 0) {
+		WaterHandler groundHandler;
+		groundHandler.blockingLayer = layers.ground2Layer;
+		groundHandler.blockingLayer_overlay_1 = layers.ground2OverlayLayer;
+		groundHandler.setupTiles(groundTile);
+		groundHandler.updateRect(tm, 0, 0, width, height);
+	}
+	tm.properties["type"].value = GetGeneratedBiome(worldSeed, region_x, region_y, width, height);
+}
@@ -0,0 +1,63 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2020 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/sago007/saland
+===========================================================================
+*/
+
+#ifndef TERRAIN_REGIONGENERATOR_HPP
+#define TERRAIN_REGIONGENERATOR_HPP
+
+#include "../sagotmx/tmx_struct.h"
+#include "../sagotmx/tile_attributes.h"
+#include <cstdint>
+
+/**
+ * The layers the generator writes to. Indexes into TileMap::layers
+ */
+struct RegionGeneratorLayers {
+	int ground2Layer = -1;
+	int ground2OverlayLayer = -1;
+	int blockingLayer = -1;
+	int blockingLayer_overlay_1 = -1;
+};
+
+/**
+ * A seed for everything random about a region, like where its lake is. The same world seed and region always give the same value.
+ */
+uint64_t RegionSeed(uint64_t worldSeed, int region_x, int region_y);
+
+/**
+ * The biome of a region: "forrest" or "desert". A pure function of the world seed and the region coordinates.
+ */
+std::string GetGeneratedBiome(uint64_t worldSeed, int region_x, int region_y, int regionWidth, int regionHeight);
+
+/**
+ * Generates the terrain of a region into a map that has the layers and tilesets of a template.
+ * Elevation and moisture are noise over the coordinates of the tile in the whole world, so the terrain continues across
+ * region borders and the result only depends on the world seed and the region coordinates.
+ * Low elevation becomes water on the blocking layer and low moisture becomes ground on ground_2. Both are autotiled afterwards.
+ * The gates in the middle of the borders and the player start are kept free of water.
+ * The water and ground tiles are the "water" and "ground" autotiles of the tileset. Nothing is generated if they are missing.
+ * Sets the "type" property of the map to the biome.
+ */
+void GenerateRegion(sago::tiled::TileMap& tm, const RegionGeneratorLayers& layers, const sago::tiled::TileAttributeTable& attributes,
+		uint64_t worldSeed, int region_x, int region_y);
+
+#endif  //TERRAIN_REGIONGENERATOR_HPP
@@ -55,6 +55,11 @@ void WaterHandler::setupTiles(uint32_t start_tile) {
 	        };
 }
 
+void WaterHandler::setupAttributes(const sago::tiled::TileAttributeTable& table, const std::string& liquid_name) {
+	attributes = &table;
+	liquid = table.liquidId(liquid_name);
+}
+
 uint32_t WaterHandler::getTile(sago::tiled::TileMap& tm, int x, int y, uint32_t& overlay_tile) {
 	std::string theString = stringForTileSurrounding(tm, x, y);
 	uint32_t tile = tile_map[theString];
@@ -117,21 +122,41 @@ void WaterHandler::updateFirstTile(sago::tiled::TileMap& tm, int x, int y) {
 	}
 }
 
+void WaterHandler::updateRect(sago::tiled::TileMap& tm, int x, int y, int w, int h) {
+	if (blockingLayer_overlay_1 < 0 || blockingLayer < 0) {
+		std::cerr << "blocking layers not set on WaterHandler\n";
+		return;
+	}
+	sago::tiled::TileGrid& blocking = tm.layers.at(blockingLayer).data.tiles;
+	sago::tiled::TileGrid& overlay = tm.layers.at(blockingLayer_overlay_1).data.tiles;
+	for (int j = y; j < y+h; ++j) {
+		for (int i = x; i < x+w; ++i) {
+			if (!blocking.inBounds(i, j) || !overlay.inBounds(i, j) || !isWaterTile(blocking.get(i, j))) {
+				continue;
+			}
+			uint32_t overlay_tile;
+			blocking.set(i, j, getTile(tm, i, j, overlay_tile));
+			overlay.set(i, j, overlay_tile);
+		}
+	}
+}
+
 void WaterHandler::updateTile(sago::tiled::TileMap& tm, int x, int y) {
-	if (x < 0 || y < 0 || x > tm.width || y > tm.height) {
+	sago::tiled::TileGrid& blocking = tm.layers.at(blockingLayer).data.tiles;
+	sago::tiled::TileGrid& overlay = tm.layers.at(blockingLayer_overlay_1).data.tiles;
+	if (!blocking.inBounds(x, y) || !overlay.inBounds(x, y)) {
 		//Out of bound. Do nothing
 		return;
 	}
-	int layer_number = blockingLayer;
-	uint32_t current_tile = sago::tiled::getTileFromLayer(tm, tm.layers.at(layer_number), x, y);
-	uint32_t current_overlay_tile = sago::tiled::getTileFromLayer(tm, tm.layers.at(blockingLayer_overlay_1), x, y);
+	uint32_t current_tile = blocking.get(x, y);
+	uint32_t current_overlay_tile = overlay.get(x, y);
 	std::cout << "tile: " << current_tile << ", surrounding: " << stringForTileSurrounding(tm, x, y) << "\n";
 	if (isWaterTile(current_tile)) {
 		uint32_t overlay_tile;
 		uint32_t tile = getTile(tm, x, y, overlay_tile);
 		if (tile != current_tile || overlay_tile != current_overlay_tile) {
-			sago::tiled::setTileOnLayerNumber(tm, layer_number, x, y, tile);
-			sago::tiled::setTileOnLayerNumber(tm, blockingLayer_overlay_1, x, y, overlay_tile);
+			blocking.set(x, y, tile);
+			overlay.set(x, y, overlay_tile);
 			updateTile(tm, x-1, y-1);
 			updateTile(tm, x, y-1);
 			updateTile(tm, x+1, y-1);
@@ -145,17 +170,19 @@ void WaterHandler::updateTile(sago::tiled::TileMap& tm, int x, int y) {
 }
 
 bool WaterHandler::isWaterTile(uint32_t tile) const {
+	if (liquid) {
+		return attributes->get(tile).liquid == liquid;
+	}
 	return tiles.find(tile) != tiles.end();
 }
 
 bool WaterHandler::isWater(const sago::tiled::TileMap& tm, int x, int y) const {
-	if (x < 0 || y < 0 || x >= tm.width || y >= tm.height) {
+	const sago::tiled::TileGrid& blocking = tm.layers.at(blockingLayer).data.tiles;
+	if (!blocking.inBounds(x, y)) {
 		//Assume that "water" is around the map
 		return true;
 	}
-	int layer_number = blockingLayer;
-	uint32_t current_tile = sago::tiled::getTileFromLayer(tm, tm.layers.at(layer_number), x, y);
-	return tiles.find(current_tile) != tiles.end();
+	return isWaterTile(blocking.get(x, y));
 }
 
 std::string WaterHandler::stringForTileSurrounding(const sago::tiled::TileMap& tm, int x, int y) const {
@@ -26,6 +26,7 @@ https://github.com/sago007/saland
 
 #include <unordered_set>
 #include "../sagotmx/tmx_struct.h"
+#include "../sagotmx/tile_attributes.h"
 
 struct WaterHandler {
 	std::unordered_set<uint32_t> tiles;
@@ -33,15 +34,31 @@ struct WaterHandler {
 	uint32_t default_tile = 28;
 	int blockingLayer = -1;
 	int blockingLayer_overlay_1 = -1;
+	const sago::tiled::TileAttributeTable* attributes = nullptr;
+	uint8_t liquid = 0;
 
 	WaterHandler();
 
 	void setupTiles(uint32_t start_tile);
 
+	/**
+	 * Recognizes the tiles by the liquid attribute in the tileset instead of the gids from setupTiles.
+	 * The gids from setupTiles are still used if no tile has the liquid.
+	 * @param table The attributes of the map. Must outlive the handler
+	 * @param liquid_name The value of the liquid property
+	 */
+	void setupAttributes(const sago::tiled::TileAttributeTable& table, const std::string& liquid_name);
+
 	uint32_t getTile(sago::tiled::TileMap& tm, int x, int y, uint32_t& overlay_tile);
 
 	void updateFirstTile(sago::tiled::TileMap& tm, int x, int y);
 
+	/**
+	 * Picks the right tile for every liquid tile in a rectangle in a single pass.
+	 * For when all the liquid has been placed already, like when a region is generated. Cheaper than updateFirstTile per tile.
+	 */
+	void updateRect(sago::tiled::TileMap& tm, int x, int y, int w, int h);
+
 	bool isWaterTile(uint32_t tile) const;
 
 	bool isWater(const sago::tiled::TileMap& tm, int x, int y) const;
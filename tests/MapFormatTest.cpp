@@ -0,0 +1,288 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2021 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/salandgame/saland
+===========================================================================
+*/
+
+/*
+ * Round trips of maps through the formats in sagotmx. They only use memory, no files.
+ */
+
+#include "TestCheck.hpp"
+#include "../src/sagotmx/tmx_binary.h"
+#include "../src/sagotmx/tmx_base64.h"
+#include "../src/sagotmx/tmx_delta.h"
+#include "../src/sagotmx/tmx_journal.h"
+#include "../src/sagotmx/tile_attributes.h"
+#include <random>
+
+using namespace sago::tiled;
+
+static const char* const embeddedTilesetMap =
+R"(<?xml version="1.0" encoding="UTF-8"?>
+<map version="1.2" orientation="orthogonal" renderorder="right-down" width="4" height="3" tilewidth="32" tileheight="32" nextobjectid="1">
+ <tileset firstgid="1" name="embedded" tilewidth="32" tileheight="32" tilecount="64">
+  <image source="terrain.png" width="256" height="256"/>
+  <terraintypes>
+   <terrain name="Water" tile="3"/>
+  </terraintypes>
+  <tile id="3" terrain="0,0,0,0" probability="0.5">
+   <properties>
+    <property name="liquid" value="water"/>
+    <property name="speed" type="float" value="0.5"/>
+   </properties>
+  </tile>
+  <tile id="5">
+   <properties>
+    <property name="blocking" type="bool" value="true"/>
+   </properties>
+  </tile>
+ </tileset>
+ <layer name="ground" width="4" height="3">
+  <data encoding="csv">
+1,2,3,4,
+4,4,4,4,
+6,0,0,6
+</data>
+ </layer>
+</map>
+)";
+
+static void TestBinaryKeepsEmbeddedTileset() {
+	const TileMap original = string2tilemap(embeddedTilesetMap);
+	const TileMap loaded = binary2tilemap(tilemap2binary(original));
+	Check(loaded.tileset.size() == 1, "Tileset missing after binary round trip");
+	if (loaded.tileset.size() != 1) {
+		return;
+	}
+	const TileSet& ts = loaded.tileset[0];
+	Check(ts.name == "embedded" && ts.image.source == "terrain.png", "Tileset header changed");
+	Check(ts.terrainTypes.size() == 1 && ts.terrainTypes[0].name == "Water" && ts.terrainTypes[0].tile == 3, "Terrain lost");
+	Check(ts.tiles.size() == 2 && ts.tiles_map.size() == 2, "Tiles lost");
+	if (ts.tiles.size() == 2) {
+		Check(ts.tiles[0].id == 3 && ts.tiles[0].terrain == "0,0,0,0" && ts.tiles[0].probability == "0.5", "Tile changed");
+		Check(ts.tiles[0].properties.count("liquid") && ts.tiles[0].properties.at("liquid").value == "water", "Tile property lost");
+		Check(ts.tiles[0].properties.count("speed") && ts.tiles[0].properties.at("speed").type == "float", "Tile property type lost");
+	}
+	const TileAttributeTable attributes = buildTileAttributes(loaded);
+	Check(attributes.get(4).liquid == attributes.liquidId("water") && attributes.liquidId("water") != 0, "Liquid attribute lost");
+	Check(attributes.get(4).speed == 0.5f, "Speed attribute lost");
+	Check(attributes.hasFlag(6, TILE_BLOCKING), "Blocking attribute lost");
+	Check(loaded.layers.at(0).data.tiles == original.layers.at(0).data.tiles, "Tiles changed by binary round trip");
+}
+
+/**
+ * A map of several chunks with an empty layer, scattered tiles and an object group
+ */
+static TileMap MakeTestMap() {
+	TileMap m = string2tilemap(embeddedTilesetMap);
+	m.width = 70;
+	m.height = 40;
+	for (const char* name : {"ground", "empty", "scattered"}) {
+		TileLayer l;
+		l.name = name;
+		l.width = m.width;
+		l.height = m.height;
+		l.data.tiles.resize(m.width, m.height);
+		m.layers.push_back(l);
+	}
+	m.layers.erase(m.layers.begin());
+	m.layers[0].data.tiles.fill(4);
+	m.layers[0].data.tiles.fillRect(10, 10, 20, 5, 6);
+	for (int i = 0; i < 40; ++i) {
+		m.layers[2].data.tiles.set((i*37)%m.width, (i*11)%m.height, 1+i%8);
+	}
+	TileObjectGroup group;
+	group.name = "objects";
+	TileObject object;
+	object.id = 1;
+	object.name = "chest";
+	object.type = "blocking";
+	object.x = 64;
+	object.y = 96;
+	object.polygon_points = {{0, 0}, {32, 0}, {16, 24}};
+	object.properties["item"].name = "item";
+	object.properties["item"].value = "sword";
+	group.add(object);
+	m.object_groups.push_back(group);
+	m.nextobjectid = 2;
+	setMapProperty(m, "seed", "42");
+	return m;
+}
+
+static std::string ObjectGroupBytes(const TileObjectGroup& group) {
+	std::string ret;
+	BinaryWriter w(ret);
+	binary_write_objectgroup(w, group);
+	return ret;
+}
+
+/**
+ * Checks that b holds the same layers, objects and properties as a. Pending chunks are loaded first
+ */
+static void CheckSameMap(const TileMap& a, TileMap b, const std::string& what) {
+	loadAllPendingChunks(b);
+	Check(a.width == b.width && a.height == b.height && a.nextobjectid == b.nextobjectid, what + ": Map header changed");
+	Check(getMapProperty(b, "seed") == getMapProperty(a, "seed"), what + ": Map property lost");
+	Check(a.layers.size() == b.layers.size(), what + ": Layers lost");
+	for (size_t i = 0; i < a.layers.size() && i < b.layers.size(); ++i) {
+		Check(a.layers[i].name == b.layers[i].name && a.layers[i].data.tiles == b.layers[i].data.tiles, what + ": Layer " + a.layers[i].name + " changed");
+	}
+	Check(a.object_groups.size() == b.object_groups.size(), what + ": Object groups lost");
+	for (size_t i = 0; i < a.object_groups.size() && i < b.object_groups.size(); ++i) {
+		Check(ObjectGroupBytes(a.object_groups[i]) == ObjectGroupBytes(b.object_groups[i]), what + ": Object group " + a.object_groups[i].name + " changed");
+	}
+}
+
+static void TestEveryCodecRoundTrips() {
+	const TileMap original = MakeTestMap();
+	for (const std::string& codec : getLayerCodecNames()) {
+		TileMap m = original;
+		setLayerCodec(m, codec);
+		CheckSameMap(original, string2tilemap(tilemap2string(m)), "TMX with " + codec);
+		CheckSameMap(original, binary2tilemap(tilemap2binary(m)), "Binary with " + codec);
+	}
+	TileMap m = original;
+	CheckThrows([&m]() {
+		setLayerCodec(m, "no_such_codec");
+	}, "Unknown codec was accepted");
+#ifdef SAGOTMX_WITH_ZSTD
+	Check(hasLayerCompression("zstd"), "zstd missing in a build with SAGOTMX_WITH_ZSTD");
+#else
+	Check(!hasLayerCompression("zstd"), "zstd reported as available in a build without it");
+	// A map saved by a build with zstd must fail with a message instead of loading empty layers
+	std::string tmx = embeddedTilesetMap;
+	const std::string csv = "<data encoding=\"csv\">\n1,2,3,4,\n4,4,4,4,\n6,0,0,6\n</data>";
+	tmx.replace(tmx.find(csv), csv.size(), "<data encoding=\"base64\" compression=\"zstd\">KLUv/SAwgQAA</data>");
+	CheckThrows([&tmx]() {
+		string2tilemap(tmx);
+	}, "zstd layer loaded in a build without zstd");
+#endif
+}
+
+static void TestBase64() {
+	const char* const vectors[][2] = {{"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"}, {"foob", "Zm9vYg=="},
+		{"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"}};
+	for (const auto& vector : vectors) {
+		const std::string plain = vector[0];
+		std::string code(base64_encoded_length(plain.size()), '\0');
+		code.resize(base64_encode(plain.data(), plain.size(), &code[0]));
+		Check(code == vector[1], "base64 of \"" + plain + "\" is " + code);
+		std::string decoded(base64_decoded_max_length(code.size()), '\0');
+		decoded.resize(base64_decode(code.data(), code.size(), &decoded[0]));
+		Check(decoded == plain, "base64 decoding of " + code + " failed");
+	}
+	// Long enough for the vector kernels. The whitespace is what Tiled writes around the data
+	std::mt19937 gen(7);
+	std::string data(1000, '\0');
+	for (char& c : data) {
+		c = static_cast<char>(gen());
+	}
+	std::string code(base64_encoded_length(data.size()), '\0');
+	code.resize(base64_encode(data.data(), data.size(), &code[0]));
+	code = "\n   " + code.substr(0, 500) + "\n " + code.substr(500) + "\n";
+	std::string decoded(base64_decoded_max_length(code.size()), '\0');
+	decoded.resize(base64_decode(code.data(), code.size(), &decoded[0]));
+	Check(decoded == data, "base64 round trip with whitespace failed");
+}
+
+static void TestSparseChunks() {
+	TileGrid grid(100, 40);
+	Check(grid.nonEmptyChunks() == 0 && grid.countNonZero() == 0, "New grid is not empty");
+	grid.set(50, 20, 3);
+	Check(grid.nonEmptyChunks() == 1 && grid.countNonZero() == 1 && grid.get(50, 20) == 3, "Set tile was not stored in one chunk");
+	TileGrid copy = grid;
+	Check(copy == grid && copy.revision() == grid.revision(), "Copy differs from the grid");
+	copy.set(51, 20, 4);
+	copy.set(0, 0, 5);
+	Check(grid.get(51, 20) == 0 && grid.get(0, 0) == 0 && grid.nonEmptyChunks() == 1, "Changing a copy changed the original");
+	Check(copy.revision() != grid.revision(), "Revision unchanged by a change");
+	Check(!(copy == grid) && copy.nonEmptyChunks() == 2, "Changes to the copy are missing");
+	copy.set(0, 0, 0);
+	Check(copy.nonEmptyChunks() == 1, "Chunk that was emptied is still counted");
+	Check(!grid.set(100, 0, 1) && !grid.set(-1, 0, 1), "Tile outside the grid was set");
+}
+
+static void TestTemplateDelta() {
+	const TileMap base = MakeTestMap();
+	TileMap m = base;
+	setTileOnLayerNumber(m, 0, 3, 3, 1);
+	setTileOnLayerNumber(m, 0, 12, 12, 0);  //Cleared tiles must not fall back to the template
+	setTileOnLayerNumber(m, 1, 69, 39, 2);
+	TileMap delta = makeTilemapDelta(base, m, "base");
+	Check(isTilemapDelta(delta) && tilemapDeltaTemplate(delta) == "base", "Delta does not name its template");
+	Check(delta.layers[0].data.tiles.countNonZero() == 2, "Delta holds unchanged tiles");
+	Check(delta.object_groups[0].objects.empty(), "Delta holds an unchanged object group");
+	delta = binary2tilemap(tilemap2binary(delta));
+	Check(tilemapDeltaMatches(base, delta), "Delta does not match its template");
+	const TileMap applied = applyTilemapDelta(base, delta);
+	Check(!isTilemapDelta(applied), "Applied delta is still a delta");
+	CheckSameMap(m, applied, "Applied delta");
+	TileMap changedBase = base;
+	setTileOnLayerNumber(changedBase, 2, 1, 1, 7);
+	Check(!tilemapDeltaMatches(changedBase, delta), "Delta matches a changed template");
+}
+
+static void TestJournal() {
+	const TileMap saved = MakeTestMap();
+	TileMap m = saved;
+	TileMapJournal journal;
+	journal.track(m);
+	Check(journal.takeChanges(m, "1").empty(), "Journal block without changes");
+	setTileOnLayerNumber(m, 0, 5, 5, 2);
+	setTileOnLayerNumber(m, 2, 37, 11, 0);
+	const std::string first = journal.takeChanges(m, "1");
+	TileObject object;
+	object.id = 2;
+	object.name = "door";
+	m.object_groups[0].add(object);
+	setTileOnLayerNumber(m, 1, 1, 1, 8);
+	const std::string second = journal.takeChanges(m, "1");
+	Check(first.size() && second.size(), "Changes were not journaled");
+
+	TileMap replayed = saved;
+	Check(applyTilemapJournal(replayed, first+second, "1") == 2, "Journal blocks were not applied");
+	CheckSameMap(m, replayed, "Replayed journal");
+
+	replayed = saved;
+	Check(applyTilemapJournal(replayed, first+second, "2") == 0, "Blocks for another base were applied");
+	CheckSameMap(saved, replayed, "Journal for another base");
+
+	std::string damaged = second;
+	damaged[damaged.size()-1] ^= 0x55;
+	replayed = saved;
+	Check(applyTilemapJournal(replayed, first+damaged, "1") == 1, "Block with a wrong checksum was applied");
+	Check(replayed.layers[0].data.tiles.get(5, 5) == 2 && replayed.layers[1].data.tiles.get(1, 1) == 0, "Blocks before a damaged one were not applied");
+
+	// A crash while appending leaves a partial block at the end
+	replayed = saved;
+	Check(applyTilemapJournal(replayed, first+second.substr(0, second.size()-3), "1") == 1, "Truncated block was applied");
+	replayed = saved;
+	Check(applyTilemapJournal(replayed, first.substr(0, 5), "1") == 0, "Truncated header was applied");
+}
+
+void RunMapFormatTests() {
+	TestBinaryKeepsEmbeddedTileset();
+	TestEveryCodecRoundTrips();
+	TestBase64();
+	TestSparseChunks();
+	TestTemplateDelta();
+	TestJournal();
+}
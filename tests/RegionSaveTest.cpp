@@ -0,0 +1,173 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2021 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/salandgame/saland
+===========================================================================
+*/
+
+/*
+ * Saves, resets and reloads a region through GameRegion the same way Game does when the player walks between regions.
+ * Also tests the save queue and the world settings and runs the tests of the map formats (MapFormatTest.cpp).
+ * Usage: region_save_test <data dir>
+ * The saves are written to a temporary folder that is removed afterwards.
+ */
+
+#include "TestCheck.hpp"
+#include "../src/saland/GameRegion.hpp"
+#include "../src/saland/SaveQueue.hpp"
+#include "../src/saland/model/WorldSettings.hpp"
+#include "../src/sago/SagoMisc.hpp"
+#include <physfs.h>
+#include <filesystem>
+#include <iostream>
+
+static const std::string worldName = "region_save_test";
+static const int regionX = -1;  //A generated forrest region
+static const int regionY = 0;
+
+static uint32_t GetTile(const GameRegion& region, int layer, int x, int y) {
+	return region.world.tm.layers.at(layer).data.tiles.get(x, y);
+}
+
+static void SetTile(GameRegion& region, int layer, int x, int y, uint32_t tile) {
+	sago::tiled::setTileOnLayerNumber(region.world.tm, layer, x, y, tile);
+}
+
+/**
+ * Flushes the current region and enters another one. Like Game::ResetWorld
+ */
+static void Enter(GameRegion& region, int x, int y, bool forceResetWorld) {
+	region.FlushRegion();
+	region.Init(x, y, worldName, forceResetWorld);
+}
+
+static void TestEditsSurviveLeaving(GameRegion& region) {
+	region.Init(regionX, regionY, worldName, true);  //Leaves the default region of the constructor unsaved
+	SetTile(region, 0, 40, 40, 7);
+	Enter(region, regionX, regionY+1, false);  //Saved in full
+	Enter(region, regionX, regionY, false);
+	Check(GetTile(region, 0, 40, 40) == 7, "Edit before the first save was lost");
+	SetTile(region, 0, 41, 40, 8);
+	Enter(region, regionX, regionY+1, false);  //Journaled
+	Enter(region, regionX, regionY, false);
+	Check(GetTile(region, 0, 40, 40) == 7, "Saved edit was lost after a journal flush");
+	Check(GetTile(region, 0, 41, 40) == 8, "Journaled edit was lost");
+}
+
+static void TestEditsSurviveReset(GameRegion& region) {
+	Enter(region, regionX, regionY, true);
+	const uint32_t generated = GetTile(region, 0, 40, 40);
+	SetTile(region, 0, 40, 40, generated+1);
+	Enter(region, regionX, regionY+1, false);
+	Enter(region, regionX, regionY, false);
+	Enter(region, regionX, regionY, true);  //reset_region
+	Check(GetTile(region, 0, 40, 40) == generated, "Reset did not regenerate the region");
+	SetTile(region, 0, 42, 40, 9);
+	Enter(region, regionX, regionY+1, false);
+	Enter(region, regionX, regionY, false);
+	Check(GetTile(region, 0, 40, 40) == generated, "Edit from before the reset came back");
+	Check(GetTile(region, 0, 42, 40) == 9, "Edit made after the reset was lost");
+}
+
+/**
+ * Makes the writes of a file fail by putting a folder where its temporary file would be written
+ */
+static std::filesystem::path BlockWrites(const std::string& filename) {
+	const std::filesystem::path tempFile = std::filesystem::path(PHYSFS_getWriteDir()) / (filename+".tmp");
+	std::filesystem::create_directories(tempFile);
+	return tempFile;
+}
+
+static void TestFailedWriteKeepsOldFile() {
+	const std::string filename = "worlds/"+worldName+"/queue_test.txt";
+	auto write = [](const std::string& content) {
+		return [content](std::ostream& out) {
+			out << content;
+		};
+	};
+	Check(QueueFileWrite(filename, write("old"), "").get(), "Queued write failed");
+	const std::filesystem::path blocked = BlockWrites(filename);
+	Check(!QueueFileWrite(filename, write("new"), "").get(), "Failed write was reported as saved");
+	Check(sago::GetFileContent(filename) == "old", "Failed write changed the file");
+	std::filesystem::remove(blocked);
+	Check(QueueFileWrite(filename, write("new"), "").get() && sago::GetFileContent(filename) == "new", "Write after a failed write failed");
+	const std::string folder = "worlds/"+worldName+"/maps";
+	Check(!QueueFileAppend(folder, "data").get(), "Failed append was reported as saved");
+}
+
+static void TestFailedRegionSaveIsRepeated(GameRegion& region) {
+	Enter(region, regionX, regionY, false);
+	const uint32_t saved = GetTile(region, 0, 40, 40);
+	SetTile(region, 0, 43, 40, 11);
+	const std::filesystem::path blocked = BlockWrites(region.GetFilename());
+	region.SaveRegion();
+	WaitForAllQueuedFiles();
+	std::filesystem::remove(blocked);
+	region.FlushRegion();  //Must save in full, as the journal would be for a base that was never written
+	Enter(region, regionX, regionY+1, false);
+	Enter(region, regionX, regionY, false);
+	Check(GetTile(region, 0, 40, 40) == saved, "Region changed by a failed save");
+	Check(GetTile(region, 0, 43, 40) == 11, "Edit was lost after a failed save");
+}
+
+static void TestUnavailableCodecFallsBack() {
+	const std::string world = "codec_test";
+	const std::string filename = "worlds/"+world+"/world.json";
+	const WorldSettings defaults;
+	sago::WriteFileContent(filename.c_str(), R"({"layer_codec": "no_such_codec"})");
+	Check(LoadWorldSettings(world).layer_codec == defaults.layer_codec, "Unknown codec was not replaced by the default");
+	sago::WriteFileContent(filename.c_str(), R"({"layer_codec": "zstd"})");
+	const std::string expected = sago::tiled::hasLayerCompression("zstd") ? "zstd" : defaults.layer_codec;
+	Check(LoadWorldSettings(world).layer_codec == expected, "zstd setting not handled for this build");
+	sago::WriteFileContent(filename.c_str(), R"({"layer_codec": "zlib"})");
+	Check(LoadWorldSettings(world).layer_codec == "zlib", "Available codec was replaced");
+}
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " <data dir>\n";
+		return 2;
+	}
+	const std::filesystem::path saveDir = std::filesystem::temp_directory_path() / "saland_region_save_test";
+	std::filesystem::remove_all(saveDir);
+	std::filesystem::create_directories(saveDir / "worlds" / worldName / "maps");
+	PHYSFS_init(argv[0]);
+	PHYSFS_mount(argv[1], nullptr, 0);
+	PHYSFS_mount(saveDir.string().c_str(), nullptr, 0);
+	PHYSFS_setWriteDir(saveDir.string().c_str());
+	RunMapFormatTests();
+	TestFailedWriteKeepsOldFile();
+	TestUnavailableCodecFallsBack();
+	{
+		GameRegion region;
+		TestEditsSurviveLeaving(region);
+		TestEditsSurviveReset(region);
+		TestFailedRegionSaveIsRepeated(region);
+		region.FlushRegion();
+		WaitForAllQueuedFiles();
+	}
+	PHYSFS_deinit();
+	std::filesystem::remove_all(saveDir);
+	if (CheckFailures()) {
+		std::cerr << CheckFailures() << " checks failed\n";
+		return 1;
+	}
+	std::cout << "All checks passed\n";
+	return 0;
+}
@@ -0,0 +1,64 @@
+/*
+===========================================================================
+ * Saland Adventures
+Copyright (C) 2014-2021 Poul Sander
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see http://www.gnu.org/licenses/
+
+Source information and contacts persons can be found at
+https://github.com/salandgame/saland
+===========================================================================
+*/
+
+#ifndef TESTCHECK_HPP
+#define TESTCHECK_HPP
+
+#include <iostream>
+#include <string>
+
+/**
+ * @return The number of failed checks so far
+ */
+inline int& CheckFailures() {
+	static int failures = 0;
+	return failures;
+}
+
+inline void Check(bool condition, const std::string& message) {
+	if (!condition) {
+		std::cerr << "FAILED: " << message << "\n";
+		++CheckFailures();
+	}
+}
+
+/**
+ * Checks that the code throws
+ */
+template <class Func>
+void CheckThrows(Func func, const std::string& message) {
+	try {
+		func();
+	}
+	catch (std::exception&) {
+		return;
+	}
+	Check(false, message);
+}
+
+/**
+ * Tests of the map formats in sagotmx. See MapFormatTest.cpp
+ */
+void RunMapFormatTests();
+
+#endif  //TESTCHECK_HPP